@@ -0,0 +1,135 @@
+// Times the .obj loader against the fscanf loop it replaced, on the same files.
+// Usage: obj_load_benchmark [runs] [file.obj ...], run from the source directory
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "common/obj_parser.hpp"
+
+namespace {
+
+// The original Model::loadObj loop, kept as the baseline to measure against
+bool loadObjFscanf(const char *path, std::vector<glm::vec3> &outVertices, std::vector<glm::vec2> &outUVs,
+                   std::vector<glm::vec3> &outNormals) {
+    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+    std::vector<glm::vec3> tempVertices;
+    std::vector<glm::vec2> tempUVs;
+    std::vector<glm::vec3> tempNormals;
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    while (true) {
+        char lineHeader[128];
+        if (fscanf(file, "%127s", lineHeader) == EOF) {
+            break;
+        }
+        if (strcmp(lineHeader, "v") == 0) {
+            glm::vec3 vertex;
+            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
+            tempVertices.push_back(vertex);
+        } else if (strcmp(lineHeader, "vt") == 0) {
+            glm::vec2 uv;
+            fscanf(file, "%f %f\n", &uv.x, &uv.y);
+            tempUVs.push_back(uv);
+        } else if (strcmp(lineHeader, "vn") == 0) {
+            glm::vec3 normal;
+            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
+            tempNormals.push_back(normal);
+        } else if (strcmp(lineHeader, "f") == 0) {
+            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
+            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
+                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
+                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
+                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
+            if (matches != 9) {
+                fclose(file);
+                return false;
+            }
+            for (int i = 0; i < 3; i++) {
+                vertexIndices.push_back(vertexIndex[i]);
+                uvIndices.push_back(uvIndex[i]);
+                normalIndices.push_back(normalIndex[i]);
+            }
+        } else {
+            char commentBuffer[1000];
+            fgets(commentBuffer, 1000, file);
+        }
+    }
+    for (unsigned int i = 0; i < vertexIndices.size(); i++) {
+        outVertices.push_back(tempVertices[vertexIndices[i] - 1]);
+        outUVs.push_back(tempUVs[uvIndices[i] - 1]);
+        outNormals.push_back(tempNormals[normalIndices[i] - 1]);
+    }
+    fclose(file);
+    return true;
+}
+
+template <typename Function>
+double bestMilliseconds(int runs, Function function) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 10;
+    std::vector<const char*> paths;
+    for (int i = 2; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        paths = { "../assets/tux.obj", "../assets/teapot.obj" };
+    }
+
+    bool ok = true;
+    for (const char *path : paths) {
+        std::vector<glm::vec3> vertices, normals;
+        std::vector<glm::vec2> uvs;
+        if (!loadObjFscanf(path, vertices, uvs, normals)) {
+            printf("%s: cannot be read\n", path);
+            ok = false;
+            continue;
+        }
+        double before = bestMilliseconds(runs, [&] {
+            vertices.clear();
+            uvs.clear();
+            normals.clear();
+            loadObjFscanf(path, vertices, uvs, normals);
+        });
+        // Expanded to the same per corner arrays, as the old loop returned them
+        std::vector<glm::vec3> parsedVertices, parsedNormals;
+        std::vector<glm::vec2> parsedUVs;
+        double after = bestMilliseconds(runs, [&] {
+            ObjData data;
+            parseObj(path, data);
+            parsedVertices.resize(data.corners.size());
+            parsedUVs.resize(data.corners.size());
+            parsedNormals.resize(data.corners.size());
+            for (size_t i = 0; i < data.corners.size(); i++) {
+                const ObjCorner &corner = data.corners[i];
+                parsedVertices[i] = data.positions[corner.position];
+                parsedUVs[i] = data.uvs[corner.uv];
+                parsedNormals[i] = data.normals[corner.normal];
+            }
+        });
+
+        bool same = parsedVertices == vertices && parsedUVs == uvs && parsedNormals == normals;
+        printf("%s: fscanf %.2f ms, parseObj and expansion %.2f ms, %.1fx%s\n", path, before, after, before / after,
+               same ? "" : ", OUTPUT DIFFERS");
+        ok = ok && same;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include "asset_loader.hpp"
+
+#include <atomic>
+
+bool AssetState::isReady() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready;
+}
+
+void AssetState::whenReady(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+            callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+    callback();
+}
+
+void AssetState::markReady() {
+    // Callbacks schedule more work, so they run outside the lock
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        pending.swap(callbacks);
+    }
+    for (std::function<void()> &callback : pending) {
+        callback();
+    }
+}
+
+AssetLoader& AssetLoader::instance() {
+    static AssetLoader loader;
+    return loader;
+}
+
+AssetLoader::AssetLoader() {
+    // Leave a core for the context thread, which runs the uploads. The core count
+    // reads 0 when it is unknown
+    unsigned int hardware = std::thread::hardware_concurrency();
+    unsigned int count = hardware > 1 ? hardware - 1 : 1;
+    for (unsigned int i = 0; i < count; i++) {
+        workers.emplace_back(&AssetLoader::workerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workerWake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void AssetLoader::schedule(Queue queue, Dependencies dependencies, std::function<void()> job) {
+    // One count per dependency plus one held until every callback is registered
+    auto remaining = std::make_shared<std::atomic<size_t>>(dependencies.size() + 1);
+    auto release = [this, queue, remaining, job]() {
+        if (--*remaining == 0) {
+            push(queue, job);
+        }
+    };
+    for (const std::shared_ptr<AssetState> &dependency : dependencies) {
+        dependency->whenReady(release);
+    }
+    release();
+}
+
+void AssetLoader::push(Queue queue, std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        (queue == WORKERS ? workerJobs : contextJobs).push_back(std::move(job));
+    }
+    (queue == WORKERS ? workerWake : contextWake).notify_one();
+}
+
+void AssetLoader::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workerWake.wait(lock, [this] { return stopping || !workerJobs.empty(); });
+            if (workerJobs.empty()) {
+                return;
+            }
+            job = std::move(workerJobs.front());
+            workerJobs.pop_front();
+        }
+        job();
+    }
+}
+
+size_t AssetLoader::pumpUploads() {
+    std::deque<std::function<void()>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.swap(contextJobs);
+    }
+    for (std::function<void()> &job : jobs) {
+        job();
+    }
+    return jobs.size();
+}
+
+void AssetLoader::wait(const Dependencies &dependencies) {
+    // The flag is set by a context job, so it is only touched on this thread
+    auto done = std::make_shared<bool>(false);
+    schedule(CONTEXT, dependencies, [done] { *done = true; });
+    while (!*done) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            contextWake.wait(lock, [this] { return !contextJobs.empty(); });
+            job = std::move(contextJobs.front());
+            contextJobs.pop_front();
+        }
+        job();
+    }
+}
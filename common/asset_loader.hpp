@@ -0,0 +1,114 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Completion state shared by every handle type, so one load can depend on a mix
+// of meshes, textures and shaders
+class AssetState {
+public:
+    bool isReady() const;
+
+    // Runs the callback once the asset is ready, straight away if it already is
+    void whenReady(std::function<void()> callback);
+
+protected:
+    void markReady();
+
+private:
+    mutable std::mutex mutex;
+    bool ready = false;
+    std::vector<std::function<void()>> callbacks;
+};
+
+// Result of an asynchronous load, only read once it is ready
+template <typename T>
+class AssetHandle {
+public:
+    struct State : AssetState {
+        T value = T();
+
+        void complete(T result) {
+            value = std::move(result);
+            markReady();
+        }
+    };
+
+    AssetHandle() = default;
+    explicit AssetHandle(std::shared_ptr<State> state) : state(std::move(state)) {}
+
+    // Handle to a value that needs no loading
+    static AssetHandle ready(T value) {
+        auto state = std::make_shared<State>();
+        state->complete(std::move(value));
+        return AssetHandle(state);
+    }
+
+    bool isReady() const { return state && state->isReady(); }
+    const T& get() const { return state->value; }
+    std::shared_ptr<AssetState> dependency() const { return state; }
+
+private:
+    std::shared_ptr<State> state;
+};
+
+// Runs CPU side loading on a worker pool and queues the GL work that follows it
+// for the context thread. Jobs start once every handle they depend on is ready,
+// so workers never block waiting on each other
+class AssetLoader {
+public:
+    using Dependencies = std::vector<std::shared_ptr<AssetState>>;
+
+    static AssetLoader& instance();
+    ~AssetLoader();
+
+    // Work without GL calls, run on a worker thread
+    template <typename F>
+    auto async(F work, Dependencies dependencies = {}) -> AssetHandle<decltype(work())> {
+        return enqueue(WORKERS, std::move(work), std::move(dependencies));
+    }
+
+    // GL work, run on the context thread by pumpUploads or wait
+    template <typename F>
+    auto upload(F work, Dependencies dependencies = {}) -> AssetHandle<decltype(work())> {
+        return enqueue(CONTEXT, std::move(work), std::move(dependencies));
+    }
+
+    // Runs the GL work queued so far, returns the number of jobs run. Call on the context thread
+    size_t pumpUploads();
+
+    // Runs GL work on the calling context thread until every dependency is ready
+    void wait(const Dependencies &dependencies);
+
+    size_t workerCount() const { return workers.size(); }
+
+private:
+    enum Queue { WORKERS, CONTEXT };
+
+    std::mutex mutex;
+    std::condition_variable workerWake;
+    std::condition_variable contextWake;
+    std::deque<std::function<void()>> workerJobs;
+    std::deque<std::function<void()>> contextJobs;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    AssetLoader();
+
+    template <typename F>
+    auto enqueue(Queue queue, F work, Dependencies dependencies) -> AssetHandle<decltype(work())> {
+        using T = decltype(work());
+        auto state = std::make_shared<typename AssetHandle<T>::State>();
+        schedule(queue, std::move(dependencies), [state, work]() mutable { state->complete(work()); });
+        return AssetHandle<T>(state);
+    }
+
+    void schedule(Queue queue, Dependencies dependencies, std::function<void()> job);
+    void push(Queue queue, std::function<void()> job);
+    void workerLoop();
+};
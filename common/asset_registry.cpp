@@ -0,0 +1,210 @@
+#include "asset_registry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mapped_file.hpp"
+#include "texture_streamer.hpp"
+
+SharedTexture::~SharedTexture() {
+    if (id != 0 && resident) {
+        glDeleteTextures(1, &id);
+    }
+}
+
+std::shared_ptr<SharedTexture> uploadTexture(const unsigned char *pixels, int width, int height, int components,
+                                             TextureUsage usage) {
+    // The mip filters work on RGBA, so fewer components are expanded first
+    std::vector<unsigned char> rgba = expandToRgba(pixels, width, height, components);
+    std::vector<std::vector<unsigned char>> mips;
+    generateMips(rgba.data(), width, height, mipFilterFor(usage), mips);
+
+    auto texture = std::make_shared<SharedTexture>();
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    texture->bytes = rgba.size();
+    for (size_t i = 0; i < mips.size(); i++) {
+        int level = static_cast<int>(i) + 1;
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, std::max(1, width >> level), std::max(1, height >> level), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, mips[i].data());
+        texture->bytes += mips[i].size();
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.size()));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+std::shared_ptr<SharedTexture> uploadCookedTexture(const char *path, const KtxInfo &info) {
+    MappedFile file(path);
+    if (!file.isOpen() || info.levels.empty() || info.levels.back().offset + info.levels.back().size > file.size()) {
+        return nullptr;
+    }
+    auto texture = std::make_shared<SharedTexture>();
+    glGenTextures(1, &texture->id);
+    glBindTexture(GL_TEXTURE_2D, texture->id);
+    for (size_t i = 0; i < info.levels.size(); i++) {
+        const KtxLevel &level = info.levels[i];
+        const char *data = file.data() + level.offset;
+        if (info.type == 0) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), info.internalFormat, level.width,
+                                   level.height, 0, static_cast<GLsizei>(level.size), data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), info.internalFormat, level.width, level.height, 0,
+                         info.format, info.type, data);
+        }
+    }
+    texture->bytes = info.dataSize;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(info.levels.size()) - 1);
+    if (info.baseFormat == GL_RED) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+unsigned int textureFormat(int components) {
+    if (components == 1)
+        return GL_RED;
+    else if (components == 2)
+        return GL_RG;
+    else if (components == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+AssetRegistry& AssetRegistry::instance() {
+    static AssetRegistry registry;
+    return registry;
+}
+
+std::string AssetRegistry::canonicalPath(const char *path) {
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    return error ? std::string(path) : canonical.string();
+}
+
+std::shared_ptr<Mesh> AssetRegistry::mesh(const char *path, VertexCompression compression) {
+    // The same file in another vertex format is a different GPU mesh
+    std::string key = canonicalPath(path) + "#" + std::to_string(compression);
+    std::shared_ptr<Mesh> mesh = meshes[key].lock();
+    if (mesh) {
+        reportReuse("mesh", key, mesh->gpuBytes, mesh->loadMilliseconds);
+        return mesh;
+    }
+    auto pending = pendingMeshes.find(key);
+    if (pending != pendingMeshes.end()) {
+        AssetHandle<std::shared_ptr<Mesh>> loading = pending->second;
+        AssetLoader::instance().wait({ loading.dependency() });
+        reportReuse("mesh", key, loading.get()->gpuBytes, loading.get()->loadMilliseconds);
+        return loading.get();
+    }
+    mesh = std::make_shared<Mesh>(path, compression);
+    meshes[key] = mesh;
+    return mesh;
+}
+
+std::shared_ptr<SharedTexture> AssetRegistry::texture(const char *path, TextureUsage usage) {
+    std::string key = canonicalPath(path) + "#" + std::to_string(usage);
+    std::shared_ptr<SharedTexture> texture = findTexture(key);
+    if (texture) {
+        return texture;
+    }
+    texture = TextureStreamer::instance().stream(path, usage);
+    addTexture(key, texture);
+    return texture;
+}
+
+AssetHandle<std::shared_ptr<Mesh>> AssetRegistry::meshAsync(const char *path, VertexCompression compression) {
+    std::string key = canonicalPath(path) + "#" + std::to_string(compression);
+    std::shared_ptr<Mesh> mesh = meshes[key].lock();
+    if (mesh) {
+        reportReuse("mesh", key, mesh->gpuBytes, mesh->loadMilliseconds);
+        return AssetHandle<std::shared_ptr<Mesh>>::ready(mesh);
+    }
+
+    // Share a load that is still in flight, reporting the saving once it lands
+    AssetLoader &loader = AssetLoader::instance();
+    auto pending = pendingMeshes.find(key);
+    if (pending != pendingMeshes.end()) {
+        AssetHandle<std::shared_ptr<Mesh>> loading = pending->second;
+        return loader.upload([this, key, loading]() {
+            reportReuse("mesh", key, loading.get()->gpuBytes, loading.get()->loadMilliseconds);
+            return loading.get();
+        }, { loading.dependency() });
+    }
+
+    std::string file = path;
+    AssetHandle<std::shared_ptr<Mesh>> prepared = loader.async([file, compression]() {
+        return std::make_shared<Mesh>(file.c_str(), compression, false);
+    });
+    AssetHandle<std::shared_ptr<Mesh>> uploaded = loader.upload([this, key, prepared]() {
+        std::shared_ptr<Mesh> mesh = prepared.get();
+        mesh->upload();
+        meshes[key] = mesh;
+        pendingMeshes.erase(key);
+        return mesh;
+    }, { prepared.dependency() });
+    pendingMeshes[key] = uploaded;
+    return uploaded;
+}
+
+std::shared_ptr<SharedTexture> AssetRegistry::findTexture(const std::string &key) {
+    auto found = textures.find(key);
+    std::shared_ptr<SharedTexture> texture = found != textures.end() ? found->second.lock() : nullptr;
+    if (texture) {
+        reportReuse("texture", key, texture->bytes, texture->loadMilliseconds);
+    }
+    return texture;
+}
+
+void AssetRegistry::addTexture(const std::string &key, const std::shared_ptr<SharedTexture> &texture) {
+    textures[key] = texture;
+}
+
+std::vector<std::shared_ptr<Mesh>> AssetRegistry::liveMeshes() {
+    std::vector<std::shared_ptr<Mesh>> live;
+    for (auto entry = meshes.begin(); entry != meshes.end();) {
+        std::shared_ptr<Mesh> mesh = entry->second.lock();
+        if (mesh) {
+            live.push_back(std::move(mesh));
+            ++entry;
+        } else {
+            entry = meshes.erase(entry);
+        }
+    }
+    return live;
+}
+
+std::vector<std::shared_ptr<SharedTexture>> AssetRegistry::liveTextures() {
+    std::vector<std::shared_ptr<SharedTexture>> live;
+    for (auto entry = textures.begin(); entry != textures.end();) {
+        std::shared_ptr<SharedTexture> texture = entry->second.lock();
+        if (texture) {
+            live.push_back(std::move(texture));
+            ++entry;
+        } else {
+            entry = textures.erase(entry);
+        }
+    }
+    return live;
+}
+
+void AssetRegistry::reportReuse(const char *kind, const std::string &key, size_t bytes, double milliseconds) {
+    reusedAssets++;
+    savedBytes += bytes;
+    savedMilliseconds += milliseconds;
+    printf("Reusing %s %s: saved %.1f KB and %.2f ms (%zu reused, %.1f KB and %.2f ms in total)\n",
+           kind, key.c_str(), bytes / 1024.0, milliseconds, reusedAssets, savedBytes / 1024.0, savedMilliseconds);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_loader.hpp"
+#include "mesh.hpp"
+#include "texture_cooker.hpp"
+
+// GPU texture shared between materials, deleted with its last reference
+struct SharedTexture
+{
+    unsigned int id = 0;
+    size_t bytes = 0;
+    double loadMilliseconds = 0.0;
+    bool resident = true; // false while streaming, id is then a placeholder owned by the TextureStreamer
+    bool evicted = false; // showing the placeholder until a draw streams it in again
+    double lastDrawn = 0.0; // on the ResidencyManager clock
+    std::string path; // source streamed from, empty when the texture cannot be loaded again
+    TextureUsage usage = TEXTURE_COLOUR;
+
+    SharedTexture() = default;
+    SharedTexture(const SharedTexture&) = delete;
+    SharedTexture& operator=(const SharedTexture&) = delete;
+    ~SharedTexture();
+};
+
+// Uploads 8 bit pixels as RGBA with a full mip chain built on the CPU
+std::shared_ptr<SharedTexture> uploadTexture(const unsigned char *pixels, int width, int height, int components,
+                                             TextureUsage usage);
+
+// Uploads every level of a cooked texture straight from the mapped file
+std::shared_ptr<SharedTexture> uploadCookedTexture(const char *path, const KtxInfo &info);
+
+// GL pixel format for 8 bit images with 1 to 4 components
+unsigned int textureFormat(int components);
+
+// Meshes and textures keyed by canonical path, so loading the same file twice
+// returns the GPU resources of the first load. The registry only holds weak
+// references, assets are freed when the last Model using them lets go. It is
+// only used from the context thread
+class AssetRegistry {
+public:
+    static AssetRegistry& instance();
+
+    std::shared_ptr<Mesh> mesh(const char *path, VertexCompression compression = VERTEX_FLOAT);
+    // Streamed through the TextureStreamer, so it returns straight away showing a placeholder
+    // for the usage. The same file used another way is compressed differently
+    std::shared_ptr<SharedTexture> texture(const char *path, TextureUsage usage = TEXTURE_COLOUR);
+
+    // Loads on the AssetLoader workers and uploads on the context thread. A file
+    // that is already loading is not loaded a second time
+    AssetHandle<std::shared_ptr<Mesh>> meshAsync(const char *path, VertexCompression compression = VERTEX_FLOAT);
+
+    // Textures that do not come from their own file, such as images embedded in
+    // a .glb, keyed by the caller. find returns nullptr when not loaded
+    std::shared_ptr<SharedTexture> findTexture(const std::string &key);
+    void addTexture(const std::string &key, const std::shared_ptr<SharedTexture> &texture);
+
+    static std::string canonicalPath(const char *path);
+
+    // Every mesh and texture still held by a Model, for the ResidencyManager
+    std::vector<std::shared_ptr<Mesh>> liveMeshes();
+    std::vector<std::shared_ptr<SharedTexture>> liveTextures();
+
+private:
+    std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+    std::unordered_map<std::string, std::weak_ptr<SharedTexture>> textures;
+    std::unordered_map<std::string, AssetHandle<std::shared_ptr<Mesh>>> pendingMeshes;
+
+    // Totals over every duplicate load that was served from the registry
+    size_t reusedAssets = 0;
+    size_t savedBytes = 0;
+    double savedMilliseconds = 0.0;
+
+    void reportReuse(const char *kind, const std::string &key, size_t bytes, double milliseconds);
+};
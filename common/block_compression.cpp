@@ -0,0 +1,296 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <GL/glew.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSION_SSE2
+#endif
+
+namespace {
+
+// 4x4 RGBA pixels in row order
+struct Block
+{
+    alignas(16) unsigned char pixels[16][4];
+};
+
+void loadBlock(const unsigned char *rgba, int width, int height, int blockX, int blockY, Block &block)
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sourceY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            memcpy(block.pixels[y * 4 + x], rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+// Per channel minimum and maximum over the block
+void blockRange(const Block &block, unsigned char low[4], unsigned char high[4])
+{
+#ifdef BLOCK_COMPRESSION_SSE2
+    const __m128i* rows = reinterpret_cast<const __m128i*>(block.pixels);
+    __m128i minimum = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+    __m128i maximum = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+    minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(1, 0, 3, 2)));
+    maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(1, 0, 3, 2)));
+    minimum = _mm_min_epu8(minimum, _mm_shuffle_epi32(minimum, _MM_SHUFFLE(2, 3, 0, 1)));
+    maximum = _mm_max_epu8(maximum, _mm_shuffle_epi32(maximum, _MM_SHUFFLE(2, 3, 0, 1)));
+    int packedLow = _mm_cvtsi128_si32(minimum);
+    int packedHigh = _mm_cvtsi128_si32(maximum);
+    memcpy(low, &packedLow, 4);
+    memcpy(high, &packedHigh, 4);
+#else
+    memcpy(low, block.pixels[0], 4);
+    memcpy(high, block.pixels[0], 4);
+    for (int i = 1; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            low[c] = std::min(low[c], block.pixels[i][c]);
+            high[c] = std::max(high[c], block.pixels[i][c]);
+        }
+    }
+#endif
+}
+
+// Dot products of every pixel's rgb with a direction
+void projectBlock(const Block &block, const int direction[3], int dots[16])
+{
+#ifdef BLOCK_COMPRESSION_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i axis = _mm_setr_epi16(static_cast<short>(direction[0]), static_cast<short>(direction[1]),
+                                        static_cast<short>(direction[2]), 0,
+                                        static_cast<short>(direction[0]), static_cast<short>(direction[1]),
+                                        static_cast<short>(direction[2]), 0);
+    const __m128i* rows = reinterpret_cast<const __m128i*>(block.pixels);
+    for (int i = 0; i < 4; i++)
+    {
+        // Widen two pixels at a time, madd gives r*dr + g*dg and b*db per pixel, then pairs are summed
+        __m128i first = _mm_madd_epi16(_mm_unpacklo_epi8(rows[i], zero), axis);
+        __m128i second = _mm_madd_epi16(_mm_unpackhi_epi8(rows[i], zero), axis);
+        first = _mm_add_epi32(first, _mm_shuffle_epi32(first, _MM_SHUFFLE(2, 3, 0, 1)));
+        second = _mm_add_epi32(second, _mm_shuffle_epi32(second, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m128i sums = _mm_unpacklo_epi64(_mm_shuffle_epi32(first, _MM_SHUFFLE(3, 3, 2, 0)),
+                                          _mm_shuffle_epi32(second, _MM_SHUFFLE(3, 3, 2, 0)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dots + i * 4), sums);
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        dots[i] = block.pixels[i][0] * direction[0] + block.pixels[i][1] * direction[1] + block.pixels[i][2] * direction[2];
+    }
+#endif
+}
+
+uint16_t packColour(const int colour[3])
+{
+    return static_cast<uint16_t>(((colour[0] * 31 + 127) / 255) << 11 |
+                                 ((colour[1] * 63 + 127) / 255) << 5 |
+                                 ((colour[2] * 31 + 127) / 255));
+}
+
+void unpackColour(uint16_t packed, int colour[3])
+{
+    int red = packed >> 11, green = (packed >> 5) & 63, blue = packed & 31;
+    colour[0] = (red << 3) | (red >> 2);
+    colour[1] = (green << 2) | (green >> 4);
+    colour[2] = (blue << 3) | (blue >> 2);
+}
+
+void writeLittleEndian(unsigned char *out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+// Four colour BC1 block from the inset bounding box of the colours
+void encodeColour(const Block &block, unsigned char *out)
+{
+    unsigned char low[4], high[4];
+    blockRange(block, low, high);
+
+    // Insetting the box by a sixteenth lowers the error of the interpolated colours
+    int minimum[3], maximum[3];
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (high[c] - low[c]) >> 4;
+        minimum[c] = low[c] + inset;
+        maximum[c] = high[c] - inset;
+    }
+
+    // Use the box diagonal the colours run along, from the sign of red and blue's covariance with green
+    int centre[3] = { (minimum[0] + maximum[0]) / 2, (minimum[1] + maximum[1]) / 2, (minimum[2] + maximum[2]) / 2 };
+    int redGreen = 0, blueGreen = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int green = block.pixels[i][1] - centre[1];
+        redGreen += (block.pixels[i][0] - centre[0]) * green;
+        blueGreen += (block.pixels[i][2] - centre[2]) * green;
+    }
+    if (redGreen < 0)
+    {
+        std::swap(minimum[0], maximum[0]);
+    }
+    if (blueGreen < 0)
+    {
+        std::swap(minimum[2], maximum[2]);
+    }
+
+    // The first endpoint must be larger for four colour mode
+    uint16_t first = packColour(maximum), second = packColour(minimum);
+    if (first < second)
+    {
+        std::swap(first, second);
+    }
+    writeLittleEndian(out, first, 2);
+    writeLittleEndian(out + 2, second, 2);
+    if (first == second)
+    {
+        writeLittleEndian(out + 4, 0, 4);
+        return;
+    }
+
+    // Project onto the line between the decoded endpoints and round to the nearest of the
+    // four palette entries, which are ordered first, second, 2/3 first, 1/3 first
+    int start[3], end[3], direction[3];
+    unpackColour(first, end);
+    unpackColour(second, start);
+    for (int c = 0; c < 3; c++)
+    {
+        direction[c] = end[c] - start[c];
+    }
+    int length = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+    int origin = start[0] * direction[0] + start[1] * direction[1] + start[2] * direction[2];
+    int dots[16];
+    projectBlock(block, direction, dots);
+    static const uint32_t palette[4] = { 1, 3, 2, 0 };
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int distance = std::max(dots[i] - origin, 0);
+        int step = std::min((distance * 6 + length) / (2 * length), 3);
+        indices |= palette[step] << (2 * i);
+    }
+    writeLittleEndian(out + 4, indices, 4);
+}
+
+// Eight value BC4 block of one channel, between its minimum and maximum
+void encodeChannel(const Block &block, int channel, unsigned char *out)
+{
+    unsigned char low[4], high[4];
+    blockRange(block, low, high);
+    int minimum = low[channel], maximum = high[channel];
+    out[0] = static_cast<unsigned char>(maximum);
+    out[1] = static_cast<unsigned char>(minimum);
+    if (minimum == maximum)
+    {
+        writeLittleEndian(out + 2, 0, 6);
+        return;
+    }
+
+    // Palette order is maximum, minimum, then six steps down from the maximum
+    int range = maximum - minimum;
+    static const uint64_t palette[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+    uint64_t indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int step = ((block.pixels[i][channel] - minimum) * 14 + range) / (2 * range);
+        indices |= palette[step] << (3 * i);
+    }
+    writeLittleEndian(out + 2, indices, 6);
+}
+
+}
+
+size_t blockBytes(BlockFormat format)
+{
+    return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+}
+
+const char* blockFormatName(BlockFormat format)
+{
+    static const char* names[] = { "BC1", "BC3", "BC4", "BC5" };
+    return names[format];
+}
+
+unsigned int blockInternalFormat(BlockFormat format)
+{
+    switch (format)
+    {
+        case BLOCK_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+        default:        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+unsigned int blockBaseFormat(BlockFormat format)
+{
+    switch (format)
+    {
+        case BLOCK_BC1: return GL_RGB;
+        case BLOCK_BC3: return GL_RGBA;
+        case BLOCK_BC4: return GL_RED;
+        default:        return GL_RG;
+    }
+}
+
+bool blockFormatOf(unsigned int internalFormat, BlockFormat &format)
+{
+    for (BlockFormat candidate : { BLOCK_BC1, BLOCK_BC3, BLOCK_BC4, BLOCK_BC5 })
+    {
+        if (blockInternalFormat(candidate) == internalFormat)
+        {
+            format = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+void compressImage(const unsigned char *rgba, int width, int height, BlockFormat format, unsigned char *out)
+{
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    size_t bytes = blockBytes(format);
+    Block block;
+    for (int y = 0; y < blocksHigh; y++)
+    {
+        for (int x = 0; x < blocksWide; x++)
+        {
+            loadBlock(rgba, width, height, x, y, block);
+            unsigned char *target = out + (static_cast<size_t>(y) * blocksWide + x) * bytes;
+            switch (format)
+            {
+                case BLOCK_BC1:
+                    encodeColour(block, target);
+                    break;
+                case BLOCK_BC3:
+                    encodeChannel(block, 3, target);
+                    encodeColour(block, target + 8);
+                    break;
+                case BLOCK_BC4:
+                    encodeChannel(block, 0, target);
+                    break;
+                case BLOCK_BC5:
+                    encodeChannel(block, 0, target);
+                    encodeChannel(block, 1, target + 8);
+                    break;
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Block compressed formats, each storing 4x4 pixel blocks. BC1 is opaque colour,
+// BC3 colour with alpha, BC4 one channel and BC5 two, such as a normal's x and y
+enum BlockFormat { BLOCK_BC1, BLOCK_BC3, BLOCK_BC4, BLOCK_BC5 };
+
+size_t blockBytes(BlockFormat format);
+const char* blockFormatName(BlockFormat format);
+
+// GL internal format, and the uncompressed format it samples like
+unsigned int blockInternalFormat(BlockFormat format);
+unsigned int blockBaseFormat(BlockFormat format);
+
+// Format of a GL internal format, false when it is not one of the block formats
+bool blockFormatOf(unsigned int internalFormat, BlockFormat &format);
+
+// Bytes of one compressed image
+size_t compressedSize(BlockFormat format, int width, int height);
+
+// Encodes 8 bit RGBA pixels, BC4 from red and BC5 from red and green. Blocks past
+// the image edge repeat its last row and column
+void compressImage(const unsigned char *rgba, int width, int height, BlockFormat format, unsigned char *out);
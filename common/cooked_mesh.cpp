@@ -0,0 +1,245 @@
+#include "cooked_mesh.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace {
+
+const char cookedMagic[4] = { 'C', 'M', 'S', 'H' };
+const uint32_t cookedVersion = 7;
+const size_t blobAlignment = 16;
+
+// File header, followed by the blobs at the given byte offsets
+struct CookedHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t sourceHash;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t indexSize;
+    uint32_t vertexFormat;
+    float boundsMin[3];
+    float boundsMax[3];
+    float uvDensity;
+    uint64_t vertexStride;
+    uint64_t lodCount;
+    uint64_t meshletCount;
+    uint64_t vertices;
+    uint64_t indices;
+    uint64_t lods;
+    uint64_t meshlets;
+};
+
+uint64_t hashBytes(const char* data, size_t size) {
+    // FNV-1a over 8 byte words
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t align(size_t offset) {
+    return (offset + blobAlignment - 1) & ~(blobAlignment - 1);
+}
+
+bool inFile(uint64_t offset, uint64_t bytes, size_t fileSize) {
+    return offset % blobAlignment == 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+}
+
+bool stampSource(const char *path, SourceStamp &stamp, bool withHash) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        return false;
+    }
+    stamp.size = static_cast<uint64_t>(info.st_size);
+    stamp.modified = static_cast<int64_t>(info.st_mtime);
+    stamp.hash = 0;
+    if (withHash) {
+        MappedFile source(path);
+        if (!source.isOpen()) {
+            return false;
+        }
+        stamp.hash = hashBytes(source.data(), source.size());
+    }
+    return true;
+}
+
+SourceStamp stampBytes(const void *data, size_t size) {
+    SourceStamp stamp;
+    stamp.size = size;
+    stamp.hash = hashBytes(static_cast<const char*>(data), size);
+    return stamp;
+}
+
+bool sourceUnchanged(const char *path, SourceStamp &cookedFrom) {
+    SourceStamp stamp;
+    if (!stampSource(path, stamp, false) || stamp.size != cookedFrom.size) {
+        return false;
+    }
+    if (stamp.modified == cookedFrom.modified) {
+        return true;
+    }
+    if (!stampSource(path, stamp, true) || stamp.hash != cookedFrom.hash) {
+        return false;
+    }
+    cookedFrom.modified = stamp.modified;
+    return true;
+}
+
+bool writeFileReplacing(const char *path, const std::function<bool(FILE*)> &writer) {
+    std::string temporaryPath = std::string(path) + ".tmp";
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = writer(file);
+    ok = fclose(file) == 0 && ok;
+    std::error_code error;
+    if (ok) {
+        std::filesystem::rename(temporaryPath, path, error);
+    }
+    if (!ok || error) {
+        remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool patchFile(const char *path, size_t offset, const void *data, size_t size) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) {
+        return false;
+    }
+    bool ok = fseek(file, static_cast<long>(offset), SEEK_SET) == 0 && fwrite(data, 1, size, file) == size;
+    return fclose(file) == 0 && ok;
+}
+
+CookedMesh::CookedMesh(const char *path, const char *sourcePath) : file(path) {
+    if (!file.isOpen() || file.size() < sizeof(CookedHeader)) {
+        return;
+    }
+    CookedHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, cookedMagic, sizeof(cookedMagic)) != 0 || header.version != cookedVersion) {
+        return;
+    }
+
+    SourceStamp cookedFrom;
+    cookedFrom.size = header.sourceSize;
+    cookedFrom.modified = header.sourceModified;
+    cookedFrom.hash = header.sourceHash;
+    if (!sourceUnchanged(sourcePath, cookedFrom)) {
+        return;
+    }
+    if (cookedFrom.modified != header.sourceModified) {
+        patchFile(path, offsetof(CookedHeader, sourceModified), &cookedFrom.modified, sizeof(cookedFrom.modified));
+    }
+
+    uint64_t vertices = header.vertexCount;
+    VertexCompression compression = static_cast<VertexCompression>(header.vertexFormat);
+    if ((header.indexSize != 2 && header.indexSize != 4) || header.vertexFormat > VERTEX_QUANTIZED ||
+        header.vertexStride != vertexSize(compression) ||
+        !inFile(header.vertices, vertices * header.vertexStride, file.size()) ||
+        !inFile(header.indices,  header.indexCount * header.indexSize, file.size()) ||
+        header.lodCount > maxMeshLods || !inFile(header.lods, header.lodCount * sizeof(MeshLod), file.size()) ||
+        header.meshletCount > header.indexCount || !inFile(header.meshlets, header.meshletCount * sizeof(Meshlet), file.size())) {
+        return;
+    }
+    const MeshLod* lods = reinterpret_cast<const MeshLod*>(file.data() + header.lods);
+    for (uint64_t i = 0; i < header.lodCount; i++) {
+        if (lods[i].indexOffset > header.indexCount || lods[i].indexCount > header.indexCount - lods[i].indexOffset ||
+            lods[i].meshletOffset > header.meshletCount || lods[i].meshletCount > header.meshletCount - lods[i].meshletOffset) {
+            return;
+        }
+    }
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(file.data() + header.meshlets);
+    for (uint64_t i = 0; i < header.meshletCount; i++) {
+        if (meshlets[i].indexOffset > header.indexCount || meshlets[i].indexCount > header.indexCount - meshlets[i].indexOffset) {
+            return;
+        }
+    }
+
+    const char* base = file.data();
+    mesh.vertexCount = static_cast<size_t>(header.vertexCount);
+    mesh.indexCount  = static_cast<size_t>(header.indexCount);
+    mesh.indexSize   = header.indexSize;
+    mesh.compression = compression;
+    mesh.vertices    = base + header.vertices;
+    mesh.indices     = base + header.indices;
+    mesh.boundsMin   = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    mesh.boundsMax   = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    mesh.uvDensity   = header.uvDensity;
+    mesh.lodCount    = static_cast<size_t>(header.lodCount);
+    mesh.lods        = lods;
+    mesh.meshletCount = static_cast<size_t>(header.meshletCount);
+    mesh.meshlets    = meshlets;
+    valid = true;
+}
+
+bool CookedMesh::write(const char *path, const char *sourcePath, const MeshView &mesh) {
+    SourceStamp stamp;
+    if (!stampSource(sourcePath, stamp, true)) {
+        return false;
+    }
+
+    CookedHeader header = {};
+    memcpy(header.magic, cookedMagic, sizeof(cookedMagic));
+    header.version        = cookedVersion;
+    header.sourceSize     = stamp.size;
+    header.sourceModified = stamp.modified;
+    header.sourceHash     = stamp.hash;
+    header.vertexCount    = mesh.vertexCount;
+    header.indexCount     = mesh.indexCount;
+    header.indexSize      = static_cast<uint32_t>(mesh.indexSize);
+    header.vertexFormat   = static_cast<uint32_t>(mesh.compression);
+    header.vertexStride   = vertexSize(mesh.compression);
+    header.lodCount       = mesh.lodCount;
+    header.meshletCount   = mesh.meshletCount;
+    header.uvDensity      = mesh.uvDensity;
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    struct Blob { uint64_t* offset; const void* data; size_t bytes; };
+    Blob blobs[] = {
+        { &header.vertices, mesh.vertices, mesh.vertexCount * header.vertexStride },
+        { &header.indices,  mesh.indices,  mesh.indexCount * mesh.indexSize },
+        { &header.lods,     mesh.lods,     mesh.lodCount * sizeof(MeshLod) },
+        { &header.meshlets, mesh.meshlets, mesh.meshletCount * sizeof(Meshlet) },
+    };
+    size_t offset = align(sizeof(header));
+    for (Blob &blob : blobs) {
+        *blob.offset = offset;
+        offset = align(offset + blob.bytes);
+    }
+
+    return writeFileReplacing(path, [&](FILE *file) {
+        static const char padding[blobAlignment] = {};
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        size_t written = sizeof(header);
+        for (Blob &blob : blobs) {
+            ok = ok && fwrite(padding, 1, *blob.offset - written, file) == *blob.offset - written;
+            ok = ok && (blob.bytes == 0 || fwrite(blob.data, blob.bytes, 1, file) == 1);
+            written = *blob.offset + blob.bytes;
+        }
+        return ok;
+    });
+}
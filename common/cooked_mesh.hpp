@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+// Pointers to GPU-ready mesh data owned by a Model or a mapped file
+struct MeshView
+{
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t indexSize = 0;
+    VertexCompression compression = VERTEX_FLOAT;
+    const void* vertices = nullptr;
+    const void* indices = nullptr;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    float uvDensity = 0.0f;
+    size_t lodCount = 0;
+    const MeshLod* lods = nullptr;
+    size_t meshletCount = 0;
+    const Meshlet* meshlets = nullptr;
+};
+
+// Identifies the version of the source file a mesh was cooked from
+struct SourceStamp
+{
+    uint64_t size = 0;
+    int64_t modified = 0;
+    uint64_t hash = 0;
+};
+
+// Reads size and modification time, and the content hash if requested
+bool stampSource(const char *path, SourceStamp &stamp, bool withHash);
+
+// Stamp of content held in memory, its size and hash without a modification time
+SourceStamp stampBytes(const void *data, size_t size);
+
+// True when the source still matches the stamp it was cooked from. A touched but unchanged
+// source is hashed, and cookedFrom takes its new modification time for the caller to store,
+// so later checks skip the hash
+bool sourceUnchanged(const char *path, SourceStamp &cookedFrom);
+
+// Writes the file under a temporary name and renames it over path, which replaces it
+// atomically, so a crash never leaves a torn or missing file
+bool writeFileReplacing(const char *path, const std::function<bool(FILE*)> &writer);
+
+// Overwrites bytes of an existing file in place
+bool patchFile(const char *path, size_t offset, const void *data, size_t size);
+
+// Versioned binary mesh (.cmesh) whose blobs are uploaded straight from the mapping
+class CookedMesh {
+public:
+    // Maps the file, only valid when it was cooked from the current source
+    CookedMesh(const char *path, const char *sourcePath);
+
+    bool isValid() const { return valid; }
+    const MeshView& view() const { return mesh; }
+
+    static bool write(const char *path, const char *sourcePath, const MeshView &mesh);
+
+private:
+    MappedFile file;
+    MeshView mesh;
+    bool valid = false;
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// Whether the context lists the named extension. GLEW's own flags read the extension
+// string, which a core profile does not have, so check here instead. Context thread only
+bool hasExtension(const char *name);
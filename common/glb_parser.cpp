@@ -0,0 +1,357 @@
+#include "glb_parser.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "stb_image.hpp"
+
+namespace {
+
+const uint32_t glbMagic = 0x46546C67;     // "glTF"
+const uint32_t chunkJson = 0x4E4F534A;    // "JSON"
+const uint32_t chunkBin = 0x004E4942;     // "BIN\0"
+
+// Accessor component types, the matching GL enums
+const uint32_t componentByte = 5120;
+const uint32_t componentUnsignedByte = 5121;
+const uint32_t componentShort = 5122;
+const uint32_t componentUnsignedShort = 5123;
+const uint32_t componentUnsignedInt = 5125;
+const uint32_t componentFloat = 5126;
+
+const int modeTriangles = 4;
+
+// Node hierarchies deeper than this are treated as cycles
+const int maxNodeDepth = 64;
+
+size_t componentSize(uint32_t componentType) {
+    switch (componentType) {
+        case componentByte:
+        case componentUnsignedByte:  return 1;
+        case componentShort:
+        case componentUnsignedShort: return 2;
+        case componentUnsignedInt:
+        case componentFloat:         return 4;
+        default:                     return 0;
+    }
+}
+
+uint32_t componentCount(const std::string &type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2")   return 2;
+    if (type == "VEC3")   return 3;
+    if (type == "VEC4")   return 4;
+    if (type == "MAT4")   return 16;
+    return 0;
+}
+
+uint32_t readWord(const char *data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+glm::mat4 nodeTransform(const JsonValue &node) {
+    const JsonValue &matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        glm::mat4 result;
+        for (int i = 0; i < 16; i++) {
+            result[i / 4][i % 4] = static_cast<float>(matrix[i].asNumber());
+        }
+        return result;
+    }
+
+    // Translation * rotation * scale, any of which may be missing
+    const JsonValue &t = node["translation"];
+    const JsonValue &r = node["rotation"];
+    const JsonValue &s = node["scale"];
+    glm::mat4 translation(1.0f), rotation(1.0f), scale(1.0f);
+    if (t.size() == 3) {
+        translation[3] = glm::vec4(t[0].asNumber(), t[1].asNumber(), t[2].asNumber(), 1.0f);
+    }
+    if (r.size() == 4) {
+        glm::quat q(static_cast<float>(r[3].asNumber()), static_cast<float>(r[0].asNumber()),
+                    static_cast<float>(r[1].asNumber()), static_cast<float>(r[2].asNumber()));
+        rotation = glm::mat4_cast(q);
+    }
+    if (s.size() == 3) {
+        scale[0][0] = static_cast<float>(s[0].asNumber(1.0));
+        scale[1][1] = static_cast<float>(s[1].asNumber(1.0));
+        scale[2][2] = static_cast<float>(s[2].asNumber(1.0));
+    }
+    return translation * rotation * scale;
+}
+
+}
+
+float GlbAccessor::component(size_t element, uint32_t index) const {
+    const unsigned char* p = data + element * stride + index * componentSize(componentType);
+    switch (componentType) {
+        case componentFloat: {
+            float value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case componentUnsignedByte:
+            return normalized ? *p / 255.0f : *p;
+        case componentByte: {
+            int8_t value = static_cast<int8_t>(*p);
+            return normalized ? std::max(value / 127.0f, -1.0f) : value;
+        }
+        case componentUnsignedShort: {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return normalized ? value / 65535.0f : value;
+        }
+        case componentShort: {
+            int16_t value;
+            memcpy(&value, p, sizeof(value));
+            return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+        }
+        case componentUnsignedInt: {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return static_cast<float>(value);
+        }
+        default:
+            return 0.0f;
+    }
+}
+
+uint32_t GlbAccessor::index(size_t element) const {
+    const unsigned char* p = data + element * stride;
+    switch (componentType) {
+        case componentUnsignedByte:
+            return *p;
+        case componentUnsignedShort: {
+            uint16_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        case componentUnsignedInt: {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+        default:
+            return 0;
+    }
+}
+
+bool isGlbPath(const char *path) {
+    size_t length = strlen(path);
+    return length >= 4 && strcmp(path + length - 4, ".glb") == 0;
+}
+
+GlbFile::GlbFile(const char *path) : file(path) {
+    if (!file.isOpen() || file.size() < 20) {
+        return;
+    }
+    const char* data = file.data();
+    if (readWord(data) != glbMagic || readWord(data + 4) != 2 || readWord(data + 8) > file.size()) {
+        printf("%s is not a binary glTF 2.0 file\n", path);
+        return;
+    }
+    size_t length = readWord(data + 8);
+
+    // The JSON chunk comes first, then an optional BIN chunk
+    size_t jsonLength = readWord(data + 12);
+    if (readWord(data + 16) != chunkJson || jsonLength > length - 20) {
+        return;
+    }
+    if (!parseJson(data + 20, jsonLength, json)) {
+        printf("Malformed JSON chunk in %s\n", path);
+        return;
+    }
+    size_t binHeader = 20 + ((jsonLength + 3) & ~size_t(3));
+    if (binHeader + 8 <= length && readWord(data + binHeader + 4) == chunkBin &&
+        readWord(data + binHeader) <= length - binHeader - 8) {
+        bin = reinterpret_cast<const unsigned char*>(data + binHeader + 8);
+        binSize = readWord(data + binHeader);
+    }
+
+    // Walk the default scene, or every root node when the file has no scenes
+    const JsonValue &scenes = json["scenes"];
+    const JsonValue &nodes = json["nodes"];
+    if (scenes.size() > 0) {
+        const JsonValue &roots = scenes[json["scene"].asInt(0)]["nodes"];
+        for (size_t i = 0; i < roots.size(); i++) {
+            addNode(roots[i].asInt(), glm::mat4(1.0f), 0);
+        }
+    } else {
+        std::vector<bool> isChild(nodes.size(), false);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const JsonValue &children = nodes[i]["children"];
+            for (size_t c = 0; c < children.size(); c++) {
+                int child = children[c].asInt();
+                if (child >= 0 && static_cast<size_t>(child) < isChild.size()) {
+                    isChild[child] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!isChild[i]) {
+                addNode(static_cast<int>(i), glm::mat4(1.0f), 0);
+            }
+        }
+    }
+
+    // Materials refer to textures, which refer to images
+    const JsonValue &textures = json["textures"];
+    auto textureImage = [&](const JsonValue &info) {
+        return info.isObject() ? textures[info["index"].asInt()]["source"].asInt() : -1;
+    };
+    const JsonValue &materials = json["materials"];
+    for (size_t i = 0; i < materials.size(); i++) {
+        GlbMaterial material;
+        material.baseColour = textureImage(materials[i]["pbrMetallicRoughness"]["baseColorTexture"]);
+        material.normal = textureImage(materials[i]["normalTexture"]);
+        meshMaterials.push_back(material);
+    }
+
+    // Only images embedded in the BIN chunk are supported
+    const JsonValue &images = json["images"];
+    for (size_t i = 0; i < images.size(); i++) {
+        GlbImage image;
+        size_t stride;
+        if (!bufferView(images[i]["bufferView"].asInt(), image.data, image.size, stride)) {
+            image.data = nullptr;
+            image.size = 0;
+        }
+        embeddedImages.push_back(image);
+    }
+
+    valid = !meshPrimitives.empty();
+}
+
+bool GlbFile::bufferView(int index, const unsigned char *&data, size_t &size, size_t &stride) const {
+    const JsonValue &view = json["bufferViews"][index];
+    // Views into external buffers (a uri) are not supported, buffer 0 is the BIN chunk
+    if (!view.isObject() || view["buffer"].asInt(0) != 0 || !bin || !json["buffers"][0]["uri"].isNull()) {
+        return false;
+    }
+    double offset = view["byteOffset"].asNumber(0.0);
+    double length = view["byteLength"].asNumber(-1.0);
+    if (offset < 0.0 || length < 0.0 || offset + length > static_cast<double>(binSize)) {
+        return false;
+    }
+    data = bin + static_cast<size_t>(offset);
+    size = static_cast<size_t>(length);
+    stride = static_cast<size_t>(view["byteStride"].asNumber(0.0));
+    return true;
+}
+
+GlbAccessor GlbFile::accessor(int index) const {
+    GlbAccessor result;
+    const JsonValue &json = this->json["accessors"][index];
+    if (!json.isObject() || !json["sparse"].isNull()) {
+        return result;
+    }
+
+    const unsigned char* data;
+    size_t size, stride;
+    if (!bufferView(json["bufferView"].asInt(), data, size, stride)) {
+        return result;
+    }
+    uint32_t componentType = static_cast<uint32_t>(json["componentType"].asInt(0));
+    uint32_t components = componentCount(json["type"].string);
+    size_t elementSize = componentSize(componentType) * components;
+    double offset = json["byteOffset"].asNumber(0.0);
+    double count = json["count"].asNumber(0.0);
+    if (elementSize == 0 || offset < 0.0 || count < 0.0) {
+        return result;
+    }
+    stride = stride ? stride : elementSize;
+    if (count > 0.0 && offset + (count - 1.0) * stride + elementSize > static_cast<double>(size)) {
+        return result;
+    }
+
+    result.data = data + static_cast<size_t>(offset);
+    result.count = static_cast<size_t>(count);
+    result.stride = stride;
+    result.componentType = componentType;
+    result.components = components;
+    result.normalized = json["normalized"].boolean;
+    return result;
+}
+
+void GlbFile::addNode(int index, const glm::mat4 &parent, int depth) {
+    const JsonValue &node = json["nodes"][index];
+    if (!node.isObject() || depth > maxNodeDepth) {
+        return;
+    }
+    glm::mat4 transform = parent * nodeTransform(node);
+
+    const JsonValue &primitives = json["meshes"][node["mesh"].asInt()]["primitives"];
+    for (size_t i = 0; i < primitives.size(); i++) {
+        const JsonValue &primitive = primitives[i];
+        if (primitive["mode"].asInt(modeTriangles) != modeTriangles) {
+            continue;
+        }
+        const JsonValue &attributes = primitive["attributes"];
+        GlbPrimitive result;
+        result.positions = accessor(attributes["POSITION"].asInt());
+        result.normals = accessor(attributes["NORMAL"].asInt());
+        result.uvs = accessor(attributes["TEXCOORD_0"].asInt());
+        result.transform = transform;
+        result.material = primitive["material"].asInt();
+
+        // Attributes must cover every vertex, indices must be integers
+        size_t vertexCount = result.positions.count;
+        if (!result.positions.isValid() || result.positions.components != 3) {
+            continue;
+        }
+        if (result.normals.isValid() && (result.normals.count != vertexCount || result.normals.components != 3)) {
+            result.normals = GlbAccessor();
+        }
+        if (result.uvs.isValid() && (result.uvs.count != vertexCount || result.uvs.components != 2)) {
+            result.uvs = GlbAccessor();
+        }
+        if (!primitive["indices"].isNull()) {
+            result.indices = accessor(primitive["indices"].asInt());
+            if (!result.indices.isValid() || result.indices.components != 1 ||
+                result.indices.componentType == componentFloat) {
+                continue;
+            }
+        }
+        meshPrimitives.push_back(result);
+    }
+
+    const JsonValue &children = node["children"];
+    for (size_t i = 0; i < children.size(); i++) {
+        addNode(children[i].asInt(), transform, depth + 1);
+    }
+}
+
+std::vector<DecodedImage> GlbFile::decodeImages() const {
+    std::vector<DecodedImage> decoded(embeddedImages.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        stbi_set_flip_vertically_on_load_thread(1);
+        for (size_t i = next++; i < embeddedImages.size(); i = next++) {
+            const GlbImage &image = embeddedImages[i];
+            if (image.data) {
+                DecodedImage &out = decoded[i];
+                out.pixels = stbi_load_from_memory(image.data, static_cast<int>(image.size),
+                                                   &out.width, &out.height, &out.components, 0);
+            }
+        }
+    };
+
+    // The flip flag is set per thread, so decode on workers only and leave the
+    // calling thread's stb_image state alone
+    size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), embeddedImages.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return decoded;
+}
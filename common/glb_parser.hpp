@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+
+// Strided view of an accessor's elements inside the mapped BIN chunk
+struct GlbAccessor
+{
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+    size_t stride = 0;
+    uint32_t componentType = 0; // GL_FLOAT, GL_UNSIGNED_SHORT, ...
+    uint32_t components = 0;
+    bool normalized = false;
+
+    bool isValid() const { return data != nullptr; }
+    // Component of an element converted to float, normalised integers map to [0, 1] or [-1, 1]
+    float component(size_t element, uint32_t index) const;
+    uint32_t index(size_t element) const;
+};
+
+// Triangle list primitive with the world transform of the node that draws it
+struct GlbPrimitive
+{
+    GlbAccessor positions;
+    GlbAccessor normals;
+    GlbAccessor uvs;
+    GlbAccessor indices;
+    glm::mat4 transform = glm::mat4(1.0f);
+    int material = -1;
+};
+
+// Textures of a material, as indices into the file's images
+struct GlbMaterial
+{
+    int baseColour = -1;
+    int normal = -1;
+};
+
+// Encoded image bytes embedded in the BIN chunk
+struct GlbImage
+{
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+// Decoded 8 bit image, pixels owned by stb_image
+struct DecodedImage
+{
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+};
+
+// True when the path has the .glb extension
+bool isGlbPath(const char *path);
+
+// Binary glTF 2.0 file. The JSON chunk is parsed once, and accessors and images
+// point straight into the mapped BIN chunk
+class GlbFile {
+public:
+    GlbFile(const char *path);
+
+    bool isValid() const { return valid; }
+    const std::vector<GlbPrimitive>& primitives() const { return meshPrimitives; }
+    const std::vector<GlbMaterial>& materials() const { return meshMaterials; }
+    const std::vector<GlbImage>& images() const { return embeddedImages; }
+
+    // Decodes every embedded image across worker threads, vertically flipped to
+    // match the bottom-left uv origin used by the rest of the renderer
+    std::vector<DecodedImage> decodeImages() const;
+
+private:
+    MappedFile file;
+    JsonValue json;
+    const unsigned char* bin = nullptr;
+    size_t binSize = 0;
+    std::vector<GlbPrimitive> meshPrimitives;
+    std::vector<GlbMaterial> meshMaterials;
+    std::vector<GlbImage> embeddedImages;
+    bool valid = false;
+
+    GlbAccessor accessor(int index) const;
+    bool bufferView(int index, const unsigned char *&data, size_t &size, size_t &stride) const;
+    void addNode(int index, const glm::mat4 &parent, int depth);
+};
@@ -0,0 +1,251 @@
+#include "json.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const JsonValue nullValue;
+
+// Documents nested deeper than this are rejected rather than overflowing the stack
+const int maxDepth = 64;
+
+struct JsonParser
+{
+    const char* p;
+    const char* end;
+
+    void skipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    bool literal(const char *word) {
+        size_t length = strlen(word);
+        if (static_cast<size_t>(end - p) < length || memcmp(p, word, length) != 0) {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string &out, unsigned long code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned long &code) {
+        if (end - p < 4) {
+            return false;
+        }
+        char digits[5] = { p[0], p[1], p[2], p[3], 0 };
+        char* digitsEnd;
+        code = strtoul(digits, &digitsEnd, 16);
+        p += 4;
+        return digitsEnd == digits + 4;
+    }
+
+    bool parseString(std::string &out) {
+        ++p; // opening quote
+        while (p < end && *p != '"') {
+            // Copy runs without escapes in one go
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\') {
+                ++p;
+            }
+            out.append(run, p);
+            if (p < end && *p == '\\') {
+                if (++p == end) {
+                    return false;
+                }
+                char escape = *p++;
+                switch (escape) {
+                    case '"':  out += '"';  break;
+                    case '\\': out += '\\'; break;
+                    case '/':  out += '/';  break;
+                    case 'b':  out += '\b'; break;
+                    case 'f':  out += '\f'; break;
+                    case 'n':  out += '\n'; break;
+                    case 'r':  out += '\r'; break;
+                    case 't':  out += '\t'; break;
+                    case 'u': {
+                        unsigned long code;
+                        if (!hex4(code)) {
+                            return false;
+                        }
+                        // Join surrogate pairs
+                        if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                            p += 2;
+                            unsigned long low;
+                            if (!hex4(low)) {
+                                return false;
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, code);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+        }
+        if (p == end) {
+            return false;
+        }
+        ++p; // closing quote
+        return true;
+    }
+
+    bool parseNumber(double &out) {
+        // strtod would read past the end of an unterminated buffer, so copy the token
+        const char* start = p;
+        while (p < end && (strchr("+-0123456789.eE", *p) != nullptr)) {
+            ++p;
+        }
+        char token[64];
+        size_t length = static_cast<size_t>(p - start);
+        if (length == 0 || length >= sizeof(token)) {
+            return false;
+        }
+        memcpy(token, start, length);
+        token[length] = '\0';
+        char* tokenEnd;
+        out = strtod(token, &tokenEnd);
+        return tokenEnd == token + length;
+    }
+
+    bool parseValue(JsonValue &out, int depth) {
+        skipSpaces();
+        if (p == end || depth > maxDepth) {
+            return false;
+        }
+        switch (*p) {
+            case '{': {
+                out.type = JsonValue::JSON_OBJECT;
+                ++p;
+                skipSpaces();
+                if (p < end && *p == '}') {
+                    ++p;
+                    return true;
+                }
+                while (true) {
+                    skipSpaces();
+                    if (p == end || *p != '"') {
+                        return false;
+                    }
+                    out.object.emplace_back();
+                    if (!parseString(out.object.back().first)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (p == end || *p++ != ':') {
+                        return false;
+                    }
+                    if (!parseValue(out.object.back().second, depth + 1)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (p == end) {
+                        return false;
+                    }
+                    if (*p == '}') {
+                        ++p;
+                        return true;
+                    }
+                    if (*p++ != ',') {
+                        return false;
+                    }
+                }
+            }
+            case '[': {
+                out.type = JsonValue::JSON_ARRAY;
+                ++p;
+                skipSpaces();
+                if (p < end && *p == ']') {
+                    ++p;
+                    return true;
+                }
+                while (true) {
+                    out.array.emplace_back();
+                    if (!parseValue(out.array.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipSpaces();
+                    if (p == end) {
+                        return false;
+                    }
+                    if (*p == ']') {
+                        ++p;
+                        return true;
+                    }
+                    if (*p++ != ',') {
+                        return false;
+                    }
+                }
+            }
+            case '"':
+                out.type = JsonValue::JSON_STRING;
+                return parseString(out.string);
+            case 't':
+                out.type = JsonValue::JSON_BOOL;
+                out.boolean = true;
+                return literal("true");
+            case 'f':
+                out.type = JsonValue::JSON_BOOL;
+                out.boolean = false;
+                return literal("false");
+            case 'n':
+                out.type = JsonValue::JSON_NULL;
+                return literal("null");
+            default:
+                out.type = JsonValue::JSON_NUMBER;
+                return parseNumber(out.number);
+        }
+    }
+};
+
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+    return type == JSON_ARRAY && index < array.size() ? array[index] : nullValue;
+}
+
+const JsonValue& JsonValue::operator[](const char *key) const {
+    if (type == JSON_OBJECT) {
+        for (const auto &member : object) {
+            if (member.first == key) {
+                return member.second;
+            }
+        }
+    }
+    return nullValue;
+}
+
+bool parseJson(const char *text, size_t length, JsonValue &out) {
+    JsonParser parser = { text, text + length };
+    out = JsonValue();
+    if (!parser.parseValue(out, 0)) {
+        return false;
+    }
+    // Only whitespace (or the GLB chunk's space padding) may follow
+    parser.skipSpaces();
+    while (parser.p < parser.end && *parser.p == '\0') {
+        ++parser.p;
+    }
+    return parser.p == parser.end;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Parsed JSON document node. Lookups of missing keys or indices return a shared
+// null value, so chains like json["meshes"][0]["name"] never need checking
+class JsonValue {
+public:
+    enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    Type type = JSON_NULL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    bool isNull() const { return type == JSON_NULL; }
+    bool isNumber() const { return type == JSON_NUMBER; }
+    bool isString() const { return type == JSON_STRING; }
+    bool isArray() const { return type == JSON_ARRAY; }
+    bool isObject() const { return type == JSON_OBJECT; }
+
+    // Number of array elements or object members
+    size_t size() const { return type == JSON_ARRAY ? array.size() : type == JSON_OBJECT ? object.size() : 0; }
+
+    const JsonValue& operator[](size_t index) const;
+    const JsonValue& operator[](int index) const { return (*this)[index < 0 ? size_t(-1) : static_cast<size_t>(index)]; }
+    const JsonValue& operator[](const char *key) const;
+
+    double asNumber(double fallback = 0.0) const { return type == JSON_NUMBER ? number : fallback; }
+    int asInt(int fallback = -1) const { return type == JSON_NUMBER ? static_cast<int>(number) : fallback; }
+};
+
+// Parses a complete document, false on malformed input
+bool parseJson(const char *text, size_t length, JsonValue &out);
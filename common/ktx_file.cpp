@@ -0,0 +1,205 @@
+#include "ktx_file.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const uint32_t ktxEndianness = 0x04030201;
+const uint32_t maxKtxLevels = 16;
+
+// Keys of the SourceStamps stored in the key/value data, the second only in packed
+// textures, stamping the source of their alpha
+const char sourceKey[] = "cw.source";
+const char packedKey[] = "cw.packed";
+static_assert(sizeof(packedKey) == sizeof(sourceKey), "stamp entries share one layout");
+
+struct KtxHeader {
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+// Key/value entry holding a source stamp, padded to four bytes
+struct SourceEntry {
+    uint32_t keyAndValueByteSize;
+    char key[sizeof(sourceKey)];
+    unsigned char value[sizeof(uint64_t) * 3];
+    unsigned char padding[2];
+};
+
+void writeEntry(SourceEntry &entry, const char *key, const SourceStamp &stamp) {
+    entry.keyAndValueByteSize = sizeof(sourceKey) + sizeof(entry.value);
+    memcpy(entry.key, key, sizeof(sourceKey));
+    memcpy(entry.value, &stamp.size, sizeof(uint64_t));
+    memcpy(entry.value + sizeof(uint64_t), &stamp.modified, sizeof(uint64_t));
+    memcpy(entry.value + 2 * sizeof(uint64_t), &stamp.hash, sizeof(uint64_t));
+}
+
+bool readEntry(FILE *file, const char *key, SourceStamp &stamp) {
+    SourceEntry entry;
+    if (fread(&entry, sizeof(entry), 1, file) != 1 ||
+        entry.keyAndValueByteSize != sizeof(sourceKey) + sizeof(entry.value) ||
+        memcmp(entry.key, key, sizeof(sourceKey)) != 0) {
+        return false;
+    }
+    memcpy(&stamp.size, entry.value, sizeof(uint64_t));
+    memcpy(&stamp.modified, entry.value + sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&stamp.hash, entry.value + 2 * sizeof(uint64_t), sizeof(uint64_t));
+    return true;
+}
+
+size_t fileSize(FILE *file) {
+    if (fseek(file, 0, SEEK_END) != 0) {
+        return 0;
+    }
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+}
+
+bool readKtxInfo(const char *path, const char *sourcePath, KtxInfo &info, const char *packedSourcePath) {
+    SourceStamp cookedFrom, packedFrom;
+    if (!readKtxInfo(path, info, cookedFrom, packedSourcePath ? &packedFrom : nullptr)) {
+        return false;
+    }
+    int64_t modified = cookedFrom.modified, packedModified = packedFrom.modified;
+    if (!sourceUnchanged(sourcePath, cookedFrom) || (packedSourcePath && !sourceUnchanged(packedSourcePath, packedFrom))) {
+        return false;
+    }
+
+    // Store the new times of sources that were only touched, so the next check skips the hash
+    size_t modifiedOffset = sizeof(KtxHeader) + offsetof(SourceEntry, value) + sizeof(uint64_t);
+    if (cookedFrom.modified != modified) {
+        patchFile(path, modifiedOffset, &cookedFrom.modified, sizeof(int64_t));
+    }
+    if (packedSourcePath && packedFrom.modified != packedModified) {
+        patchFile(path, modifiedOffset + sizeof(SourceEntry), &packedFrom.modified, sizeof(int64_t));
+    }
+    return true;
+}
+
+bool readKtxInfo(const char *path, KtxInfo &info, SourceStamp &cookedFrom, SourceStamp *packedFrom) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    size_t size = fileSize(file);
+    KtxHeader header;
+    size_t entries = packedFrom ? 2 : 1;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.identifier, ktxIdentifier, sizeof(ktxIdentifier)) == 0 &&
+              header.endianness == ktxEndianness && (header.glType != 0 || header.glFormat == 0) &&
+              header.numberOfFaces == 1 &&
+              header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelDepth == 0 && header.numberOfArrayElements == 0 &&
+              header.numberOfMipmapLevels > 0 && header.numberOfMipmapLevels <= maxKtxLevels &&
+              header.bytesOfKeyValueData == entries * sizeof(SourceEntry) &&
+              readEntry(file, sourceKey, cookedFrom) && (!packedFrom || readEntry(file, packedKey, *packedFrom));
+    if (!ok) {
+        fclose(file);
+        return false;
+    }
+
+    // Each level is its size followed by its data, block sizes and RGBA texels keep it four byte aligned
+    info.internalFormat = header.glInternalFormat;
+    info.baseFormat = header.glBaseInternalFormat;
+    info.format = header.glFormat;
+    info.type = header.glType;
+    info.width = static_cast<int>(header.pixelWidth);
+    info.height = static_cast<int>(header.pixelHeight);
+    info.levels.clear();
+    info.dataSize = 0;
+    size_t offset = sizeof(header) + header.bytesOfKeyValueData;
+    for (uint32_t i = 0; i < header.numberOfMipmapLevels && ok; i++) {
+        uint32_t imageSize = 0;
+        ok = offset + sizeof(imageSize) <= size && fseek(file, static_cast<long>(offset), SEEK_SET) == 0 &&
+             fread(&imageSize, sizeof(imageSize), 1, file) == 1 &&
+             imageSize % 4 == 0 && imageSize <= size - offset - sizeof(imageSize);
+        KtxLevel level;
+        level.width = std::max(1, info.width >> i);
+        level.height = std::max(1, info.height >> i);
+        level.offset = offset + sizeof(imageSize);
+        level.size = imageSize;
+        info.levels.push_back(level);
+        info.dataSize += imageSize;
+        offset = level.offset + imageSize;
+    }
+    fclose(file);
+    return ok;
+}
+
+bool readKtxLevels(const char *path, const KtxInfo &info, unsigned char *out, size_t firstLevel, size_t lastLevel) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = firstLevel; i <= lastLevel && i < info.levels.size(); i++) {
+        const KtxLevel &level = info.levels[i];
+        ok = ok && fseek(file, static_cast<long>(level.offset), SEEK_SET) == 0 &&
+             fread(out, 1, level.size, file) == level.size;
+        out += level.size;
+    }
+    fclose(file);
+    return ok;
+}
+
+bool writeKtx(const char *path, const char *sourcePath, const KtxInfo &info, const unsigned char *data,
+              const char *packedSourcePath) {
+    SourceStamp stamp, packedStamp;
+    return stampSource(sourcePath, stamp, true) &&
+           (!packedSourcePath || stampSource(packedSourcePath, packedStamp, true)) &&
+           writeKtx(path, stamp, info, data, packedSourcePath ? &packedStamp : nullptr);
+}
+
+bool writeKtx(const char *path, const SourceStamp &stamp, const KtxInfo &info, const unsigned char *data,
+              const SourceStamp *packedStamp) {
+    KtxHeader header = {};
+    memcpy(header.identifier, ktxIdentifier, sizeof(ktxIdentifier));
+    header.endianness = ktxEndianness;
+    header.glType = info.type;
+    header.glTypeSize = 1;
+    header.glFormat = info.format;
+    header.glInternalFormat = info.internalFormat;
+    header.glBaseInternalFormat = info.baseFormat;
+    header.pixelWidth = static_cast<uint32_t>(info.width);
+    header.pixelHeight = static_cast<uint32_t>(info.height);
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = static_cast<uint32_t>(info.levels.size());
+    SourceEntry entries[2] = {};
+    size_t entryCount = packedStamp ? 2 : 1;
+    header.bytesOfKeyValueData = static_cast<uint32_t>(entryCount * sizeof(SourceEntry));
+    writeEntry(entries[0], sourceKey, stamp);
+    if (packedStamp) {
+        writeEntry(entries[1], packedKey, *packedStamp);
+    }
+
+    return writeFileReplacing(path, [&](FILE *file) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(entries, sizeof(SourceEntry), entryCount, file) == entryCount;
+        for (const KtxLevel &level : info.levels) {
+            uint32_t imageSize = static_cast<uint32_t>(level.size);
+            ok = ok && fwrite(&imageSize, sizeof(imageSize), 1, file) == 1 && fwrite(data, 1, level.size, file) == level.size;
+            data += level.size;
+        }
+        return ok;
+    });
+}
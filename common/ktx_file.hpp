@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cooked_mesh.hpp"
+
+// One mip level of a compressed texture
+struct KtxLevel
+{
+    int width = 0;
+    int height = 0;
+    size_t offset = 0; // byte offset of the level's data in the file
+    size_t size = 0;
+};
+
+// Header of a KTX 1.1 file holding a 2D texture with its mip chain. Format and
+// type are 0 for compressed textures
+struct KtxInfo
+{
+    unsigned int internalFormat = 0;
+    unsigned int baseFormat = 0;
+    unsigned int format = 0;
+    unsigned int type = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<KtxLevel> levels;
+    size_t dataSize = 0; // every level's data back to back
+};
+
+// Reads and checks the header, only valid when the file was cooked from the current source.
+// A packed texture takes its alpha from a second source, which has to be current too
+bool readKtxInfo(const char *path, const char *sourcePath, KtxInfo &info, const char *packedSourcePath = nullptr);
+
+// Reads and checks the header, leaving it to the caller to check what it was cooked from.
+// Packed textures only read as such when packedFrom is given
+bool readKtxInfo(const char *path, KtxInfo &info, SourceStamp &cookedFrom, SourceStamp *packedFrom = nullptr);
+
+// Reads the data of levels firstLevel to lastLevel into out, back to back. Every level by default
+bool readKtxLevels(const char *path, const KtxInfo &info, unsigned char *out, size_t firstLevel = 0,
+                   size_t lastLevel = SIZE_MAX);
+
+// Writes levels held back to back in data, stamped with the sources they were cooked from
+bool writeKtx(const char *path, const char *sourcePath, const KtxInfo &info, const unsigned char *data,
+              const char *packedSourcePath = nullptr);
+bool writeKtx(const char *path, const SourceStamp &stamp, const KtxInfo &info, const unsigned char *data,
+              const SourceStamp *packedStamp = nullptr);
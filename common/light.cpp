@@ -1,5 +1,8 @@
 #include "light.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 void Light::addPointLight(const glm::vec3 position,  const glm::vec3 colour,
                           const float constant,      const float linear,
                           const float quadratic)
@@ -40,30 +43,91 @@ void Light::addDirectionalLight(const glm::vec3 direction, const glm::vec3 colou
     lightSources.push_back(light);
 }
 
-void Light::toShader(unsigned int shaderID, glm::mat4 view)
+LightCounts Light::counts() const
+{
+    LightCounts counts;
+    for (const LightSource &light : lightSources)
+    {
+        counts.point       += light.type == 1;
+        counts.spot        += light.type == 2;
+        counts.directional += light.type == 3;
+    }
+    return counts;
+}
+
+void Light::upload(const glm::mat4 &view)
 {
-    unsigned int numLights = static_cast<unsigned int>(lightSources.size());
-    glUniform1i(glGetUniformLocation(shaderID, "numLights"), numLights);
+    // Point lights first, then spotlights, then directional lights. GLSL has no empty
+    // arrays, so the block always has at least one
+    entries.clear();
+    for (unsigned int type = 1; type <= 3; type++)
+    {
+        for (const LightSource &light : lightSources)
+        {
+            if (light.type != type)
+                continue;
+            
+            LightBlockEntry entry = {};
+            entry.position  = light.position;
+            entry.colour    = light.colour;
+            entry.direction = light.direction;
+            entry.constant  = light.constant;
+            entry.linear    = light.linear;
+            entry.quadratic = light.quadratic;
+            entry.cosPhi    = light.cosPhi;
+            entries.push_back(entry);
+        }
+    }
+    if (entries.empty())
+        entries.push_back(LightBlockEntry());
     
-    for (unsigned int i = 0; i < numLights; i++)
+    // Move every light into view space in one pass
+    glm::mat3 rotation(view);
+    for (LightBlockEntry &entry : entries)
     {
-        std::string idx = std::to_string(i);
-        glm::vec3 VSLightPosition  = glm::vec3(view * glm::vec4(lightSources[i].position, 1.0f));
-        glm::vec3 VSLightDirection = glm::vec3(view * glm::vec4(lightSources[i].direction, 0.0f));
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].position").c_str()), 1, &VSLightPosition[0]);
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].direction").c_str()), 1, &VSLightDirection[0]);
-        glUniform3fv(glGetUniformLocation(shaderID, ("lightSources[" + idx + "].colour").c_str()), 1, &lightSources[i].colour[0]);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].constant").c_str()), lightSources[i].constant);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].linear").c_str()), lightSources[i].linear);
-        glUniform1f(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].quadratic").c_str()), lightSources[i].quadratic);
-        glUniform1f (glGetUniformLocation(shaderID, ("lightSources[" + idx + "].cosPhi").c_str()), lightSources[i].cosPhi);
-        glUniform1i(glGetUniformLocation (shaderID, ("lightSources[" + idx + "].type").c_str()), lightSources[i].type);
+        entry.position  = glm::vec3(view * glm::vec4(entry.position, 1.0f));
+        entry.direction = rotation * entry.direction;
     }
+    
+    if (buffer == 0)
+        glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (entries.size() != uploaded.size())
+    {
+        glBufferData(GL_UNIFORM_BUFFER, entries.size() * sizeof(LightBlockEntry), entries.data(), GL_DYNAMIC_DRAW);
+        uploaded = entries;
+    }
+    else
+    {
+        // Send the span between the first and last light that changed
+        size_t first = entries.size(), last = 0;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (memcmp(&entries[i], &uploaded[i], sizeof(LightBlockEntry)) == 0)
+                continue;
+            first = std::min(first, i);
+            last  = i + 1;
+        }
+        if (first < last)
+        {
+            glBufferSubData(GL_UNIFORM_BUFFER, first * sizeof(LightBlockEntry), (last - first) * sizeof(LightBlockEntry),
+                            &entries[first]);
+            std::copy(entries.begin() + first, entries.begin() + last, uploaded.begin() + first);
+        }
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK, buffer);
+}
+
+void Light::release()
+{
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    uploaded.clear();
 }
 
-void Light::draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Model lightModel)
+void Light::draw(const ShaderProgram &program, glm::mat4 view, glm::mat4 projection, Model &lightModel)
 {
-    glUseProgram(shaderID);
+    glUseProgram(program.id());
     for (unsigned int i = 0; i < static_cast<unsigned int>(lightSources.size()); i++)
     {
         // Ignore directional lights
@@ -76,13 +140,14 @@ void Light::draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Mo
         glm::mat4 model     = translate * scale;
         
         // Send the MVP and MV matrices to the vertex shader
-        glm::mat4 MVP = projection * view * model;
-        glUniformMatrix4fv(glGetUniformLocation(shaderID, "MVP"), 1, GL_FALSE, &MVP[0][0]);
+        DrawBlock block;
+        block.MV  = view * model;
+        block.MVP = projection * block.MV;
 
-        // Send model, view, projection matrices and light colour to light shader
-        glUniform3fv(glGetUniformLocation(shaderID, "lightColour"), 1, &lightSources[i].colour[0]);
+        // Send light colour to light shader
+        program.set(Uniforms::lightColour, lightSources[i].colour);
 
         // Draw light source
-        lightModel.draw(shaderID);
+        lightModel.draw(program, block);
     }
 }
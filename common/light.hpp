@@ -2,6 +2,7 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 #include "model.hpp"
+#include "shader_variants.hpp"
 
 struct LightSource
 {
@@ -15,6 +16,21 @@ struct LightSource
     unsigned int type;
 };
 
+// A light as the LightBlock uniform block lays it out under std140, where a vec3
+// is aligned to 16 bytes and a float can fill the last 4
+struct LightBlockEntry
+{
+    glm::vec3 position;
+    float constant;
+    glm::vec3 colour;
+    float linear;
+    glm::vec3 direction;
+    float quadratic;
+    float cosPhi;
+    float padding[3];
+};
+static_assert(sizeof(LightBlockEntry) == 64, "LightBlockEntry must match the std140 Light struct");
+
 class Light
 {
 public:
@@ -31,9 +47,20 @@ public:
                              const float cosPhi);
     void addDirectionalLight(const glm::vec3 direction, const glm::vec3 colour);
     
-    // Send to shader
-    void toShader(unsigned int shaderID, glm::mat4 view);
+    // Lights of each type, which the lit shader variants are specialised on
+    LightCounts counts() const;
+    
+    // Send to the LightBlock buffer in view space, grouped by type in the order the
+    // variants loop over them. Only the lights that changed since the last call are sent
+    void upload(const glm::mat4 &view);
+    
+    void release();
     
     // Draw light source
-    void draw(unsigned int shaderID, glm::mat4 view, glm::mat4 projection, Model lightModel);
+    void draw(const ShaderProgram &program, glm::mat4 view, glm::mat4 projection, Model &lightModel);
+    
+private:
+    GLuint buffer = 0;
+    std::vector<LightBlockEntry> entries;  // built by each upload
+    std::vector<LightBlockEntry> uploaded; // what the buffer holds
 };
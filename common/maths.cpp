@@ -297,3 +297,18 @@ glm::vec4 Maths::clamp(glm::vec4 min, glm::vec4 max, glm::vec4 value) {
         clamp(min.w, max.w, value.w)
     );
 }
+
+void Maths::frustumPlanes(const glm::mat4& clip, glm::vec4 planes[6]) {
+    // Gribb and Hartmann, each plane is the fourth row plus or minus another row
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2 + 0] = rows[3] + rows[i];
+        planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= magnitude(glm::vec3(planes[i]));
+    }
+}
@@ -34,6 +34,9 @@ namespace Maths {
     glm::mat4 perspective(float fov, float aspect, float near, float far);
     glm::mat4 ortho(float left, float right, float bottom, float top, float near, float far);
     glm::mat4 transpose(const glm::mat4& in);
+    // Normalised left, right, bottom, top, near and far planes (xyz normal, w distance)
+    // of a clip matrix, in the space the matrix transforms from
+    void frustumPlanes(const glm::mat4& clip, glm::vec4 planes[6]);
 
     float yaw(const glm::vec3& angles);
     float pitch(const glm::vec3& angles);
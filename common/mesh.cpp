@@ -1,12 +1,625 @@
+#include <vector>
+#include <stdio.h>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
 #include "mesh.hpp"
+#include "cooked_mesh.hpp"
+#include "vertex_packing.hpp"
+#include "mesh_optimizer.hpp"
+#include "maths.hpp"
+#include "obj_parser.hpp"
+#include "glb_parser.hpp"
+#include "residency_manager.hpp"
+#include "uniform_ring.hpp"
+
+namespace {
+
+// Full attribute tuple of an unindexed vertex
+struct VertexKey
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+};
+
+// Bitwise comparison, so the hash below stays consistent with equality
+template <typename T>
+bool sameBits(const T &a, const T &b)
+{
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+// Square root of uv area over surface area, summed over every triangle
+float uvDensityOf(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+    double surface = 0.0, uv = 0.0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const Vertex &a = vertices[indices[i]], &b = vertices[indices[i + 1]], &c = vertices[indices[i + 2]];
+        surface += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        glm::vec2 u = b.uv - a.uv, v = c.uv - a.uv;
+        uv += std::fabs(u.x * v.y - u.y * v.x);
+    }
+    return surface > 0.0 ? static_cast<float>(std::sqrt(uv / surface)) : 0.0f;
+}
+
+size_t hashVertex(const VertexKey &key)
+{
+    uint32_t words[sizeof(VertexKey) / sizeof(uint32_t)];
+    memcpy(words, &key, sizeof(VertexKey));
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : words)
+    {
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+}
+
+Mesh::Mesh(const char *path, VertexCompression compression, bool uploadNow)
+    : sourcePath(path), compression(compression), staged(new MeshView())
+{
+    // Upload straight from the cooked mesh when it is up to date
+    auto start = std::chrono::steady_clock::now();
+    static const char* cookedSuffixes[] = { ".cmesh", ".packed.cmesh", ".quantized.cmesh" };
+    std::string cookedPath = std::string(path) + cookedSuffixes[compression];
+    cooked.reset(new CookedMesh(cookedPath.c_str(), path));
+    if (cooked->isValid() && cooked->view().compression == compression)
+    {
+        *staged = cooked->view();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        loadMilliseconds = elapsed.count();
+        printf("Loaded cooked mesh %s in %.2f ms\n", cookedPath.c_str(), loadMilliseconds);
+        if (uploadNow)
+        {
+            upload();
+        }
+        return;
+    }
+    cooked.reset();
+    
+    // Load object
+    bool res;
+    if (isGlbPath(path))
+    {
+        res = loadGlb(path, GlbFile(path), vertices, indices);
+    }
+    else
+    {
+        res = loadObj(path, vertices, indices);
+    }
+    calculateNormals();
+    float density = uvDensityOf(vertices, indices);
+    
+    // Build the LOD chain into one index buffer and optimise it for the GPU
+    if (!indices.empty())
+    {
+        buildLods(path);
+    }
+    
+    // Indices are stored as the GPU consumes them, 16 bit whenever the vertex count allows
+    MeshView &mesh = *staged;
+    mesh.vertexCount = vertices.size();
+    mesh.indexCount  = indices.size();
+    mesh.vertices    = vertices.data();
+    mesh.lodCount    = lods.size();
+    mesh.lods        = lods.data();
+    mesh.meshletCount = meshlets.size();
+    mesh.meshlets    = meshlets.data();
+    mesh.uvDensity   = density;
+    if (vertices.size() <= 0xFFFF)
+    {
+        stagedIndices.assign(indices.begin(), indices.end());
+        mesh.indices   = stagedIndices.data();
+        mesh.indexSize = sizeof(unsigned short);
+    }
+    else
+    {
+        mesh.indices   = indices.data();
+        mesh.indexSize = sizeof(unsigned int);
+    }
+    if (!vertices.empty())
+    {
+        mesh.boundsMin = mesh.boundsMax = vertices[0].position;
+        for (const Vertex &vertex : vertices)
+        {
+            mesh.boundsMin = glm::min(mesh.boundsMin, vertex.position);
+            mesh.boundsMax = glm::max(mesh.boundsMax, vertex.position);
+        }
+    }
+    
+    // Optionally compress the vertices, reporting the error against the float reference
+    if (compression != VERTEX_FLOAT)
+    {
+        PackingError error = packVertices(vertices.data(), vertices.size(), compression,
+                                          mesh.boundsMin, mesh.boundsMax, stagedVertices);
+        mesh.compression = compression;
+        mesh.vertices    = stagedVertices.data();
+        printf("Packed %s: %zu -> %zu bytes per vertex, max error position %.3g, uv %.3g, normal %.3f deg, tangent %.3f deg\n",
+               path, sizeof(Vertex), vertexSize(compression), error.position, error.uv,
+               error.normalDegrees, error.tangentDegrees);
+    }
+    
+    // Cook the mesh next to its source for the next launch
+    if (res && !CookedMesh::write(cookedPath.c_str(), path, mesh))
+    {
+        printf("Could not write cooked mesh %s\n", cookedPath.c_str());
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    loadMilliseconds = elapsed.count();
+    
+    if (uploadNow)
+    {
+        upload();
+    }
+}
+
+void Mesh::upload()
+{
+    if (!staged)
+    {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    setupBuffers(*staged);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    loadMilliseconds += elapsed.count();
+    
+    // The GPU has its own copy now
+    staged.reset();
+    cooked.reset();
+    std::vector<unsigned short>().swap(stagedIndices);
+    std::vector<unsigned char>().swap(stagedVertices);
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
+
+void Mesh::evict()
+{
+    if (VAO == 0)
+    {
+        return;
+    }
+    deleteBuffers();
+    gpuBytes = 0;
+}
+
+bool Mesh::restore()
+{
+    // The cooked file is current unless the source changed, which cooks it again
+    auto start = std::chrono::steady_clock::now();
+    Mesh reloaded(sourcePath.c_str(), compression, false);
+    if (!reloaded.staged || reloaded.staged->vertexCount == 0)
+    {
+        return false;
+    }
+    setupBuffers(*reloaded.staged);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("Restored mesh %s in %.2f ms\n", sourcePath.c_str(), elapsed.count());
+    return true;
+}
+
+bool Mesh::readGeometry(std::vector<glm::vec3> &positions, std::vector<unsigned int> &triangles) const
+{
+    Mesh reloaded(sourcePath.c_str(), compression, false);
+    if (!reloaded.staged || reloaded.staged->vertexCount == 0)
+    {
+        return false;
+    }
+    const MeshView &mesh = *reloaded.staged;
+    const unsigned char *vertex = static_cast<const unsigned char*>(mesh.vertices);
+    size_t stride = vertexSize(mesh.compression);
+    positions.resize(mesh.vertexCount);
+    for (size_t i = 0; i < mesh.vertexCount; i++, vertex += stride)
+    {
+        if (mesh.compression == VERTEX_QUANTIZED)
+        {
+            const QuantizedVertex *quantized = reinterpret_cast<const QuantizedVertex*>(vertex);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                positions[i][axis] = mesh.boundsMin[axis] +
+                                     (mesh.boundsMax[axis] - mesh.boundsMin[axis]) * (quantized->position[axis] / 65535.0f);
+            }
+        }
+        else
+        {
+            // Float and packed vertices both start with the float position
+            memcpy(&positions[i], vertex, sizeof(glm::vec3));
+        }
+    }
+    
+    // The full detail level comes first in the index buffer
+    size_t first = mesh.lodCount > 0 ? mesh.lods[0].indexOffset : 0;
+    size_t count = mesh.lodCount > 0 ? mesh.lods[0].indexCount : mesh.indexCount;
+    triangles.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        triangles[i] = mesh.indexSize == sizeof(unsigned short)
+                           ? static_cast<const unsigned short*>(mesh.indices)[first + i]
+                           : static_cast<const unsigned int*>(mesh.indices)[first + i];
+    }
+    return true;
+}
+
+bool Mesh::bindDrawBlock(DrawBlock &block)
+{
+    // Tell the vertex shader how to decode the vertex format
+    block.packedVertex   = compression != VERTEX_FLOAT;
+    block.positionScale  = positionScale;
+    block.positionOffset = positionOffset;
+    return UniformRing::instance().bind(DRAW_BLOCK, block);
+}
+
+void Mesh::draw(DrawBlock &block, size_t lod)
+{
+    lastDrawn = ResidencyManager::instance().now();
+    if (lods.empty() || (VAO == 0 && !restore()) || !bindDrawBlock(block))
+    {
+        return;
+    }
+    
+    // Draw the triangles of the requested level
+    const MeshLod &level = lods[std::min(lod, lods.size() - 1)];
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), indexType,
+                   (void*)(level.indexOffset * indexSize));
+    glBindVertexArray(0);
+}
+
+void Mesh::draw(DrawBlock &block, size_t lod, const glm::mat4 &modelView, const glm::mat4 &projection)
+{
+    lastDrawn = ResidencyManager::instance().now();
+    if (lods.empty() || (VAO == 0 && !restore()))
+    {
+        return;
+    }
+    const MeshLod &level = lods[std::min(lod, lods.size() - 1)];
+    if (level.meshletCount == 0)
+    {
+        draw(block, lod);
+        return;
+    }
+    
+    // Cull in object space, against the frustum planes of the model's clip matrix
+    // and from the camera position carried back through the inverse model view
+    glm::vec4 planes[6];
+    Maths::frustumPlanes(projection * modelView, planes);
+    glm::vec3 camera = glm::vec3(glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    
+    // Neighbouring visible meshlets are contiguous in the index buffer, so merge their ranges
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    drawCounts.clear();
+    drawOffsets.clear();
+    uint32_t rangeEnd = 0;
+    for (uint32_t i = level.meshletOffset; i < level.meshletOffset + level.meshletCount; i++)
+    {
+        const Meshlet &meshlet = meshlets[i];
+        if (cullMeshlet(meshlet, planes, camera))
+        {
+            continue;
+        }
+        if (!drawCounts.empty() && meshlet.indexOffset == rangeEnd)
+        {
+            drawCounts.back() += static_cast<GLsizei>(meshlet.indexCount);
+        }
+        else
+        {
+            drawCounts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+            drawOffsets.push_back((const void*)(meshlet.indexOffset * indexSize));
+        }
+        rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+    }
+    if (drawCounts.empty() || !bindDrawBlock(block))
+    {
+        return;
+    }
+    
+    glBindVertexArray(VAO);
+    glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(),
+                        static_cast<GLsizei>(drawCounts.size()));
+    glBindVertexArray(0);
+}
+
+void Mesh::setupBuffers(const MeshView &mesh)
+{
+    // Create and bind the Vertex Array Object (VAO)
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    
+    // Create one interleaved Vertex Buffer Object and describe it from the layout
+    size_t vertexBytes = vertexSize(mesh.compression);
+    glGenBuffers(1, &vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * vertexBytes, mesh.vertices, GL_STATIC_DRAW);
+    switch (mesh.compression)
+    {
+        case VERTEX_FLOAT:     VertexFormat::apply();          break;
+        case VERTEX_PACKED:    PackedVertexFormat::apply();    break;
+        case VERTEX_QUANTIZED: QuantizedVertexFormat::apply(); break;
+    }
+    
+    // Quantised positions are stored relative to the mesh bounds
+    if (mesh.compression == VERTEX_QUANTIZED)
+    {
+        positionScale  = mesh.boundsMax - mesh.boundsMin;
+        positionOffset = mesh.boundsMin;
+    }
+
+    // Create index buffer
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * mesh.indexSize, mesh.indices, GL_STATIC_DRAW);
+    indexType = mesh.indexSize == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    
+    // A mesh without a LOD table is drawn whole
+    if (mesh.lodCount > 0)
+    {
+        lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+    }
+    else
+    {
+        lods.assign(1, MeshLod{ 0, static_cast<uint32_t>(mesh.indexCount), 0, 0, 0.0f });
+    }
+    meshlets.assign(mesh.meshlets, mesh.meshlets + mesh.meshletCount);
+    boundsMin = mesh.boundsMin;
+    boundsMax = mesh.boundsMax;
+    uvDensity = mesh.uvDensity;
+
+    // Report the saving over one float vertex per triangle corner of the full detail level
+    size_t unindexedBytes = lods[0].indexCount * sizeof(Vertex);
+    size_t indexedBytes = mesh.vertexCount * vertexBytes + mesh.indexCount * mesh.indexSize;
+    gpuBytes = indexedBytes;
+    printf("Indexed geometry: %zu -> %zu vertices, %.1f KB -> %.1f KB GPU memory\n",
+           static_cast<size_t>(lods[0].indexCount), mesh.vertexCount, unindexedBytes / 1024.0, indexedBytes / 1024.0);
+    
+     // Unbind the VAO
+    glBindVertexArray(0);
+}
+
+Mesh::~Mesh()
+{
+    deleteBuffers();
+}
+
+void Mesh::deleteBuffers()
+{
+    if (VAO == 0)
+    {
+        return;
+    }
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteVertexArrays(1, &VAO);
+    VAO = vertexBuffer = indexBuffer = 0;
+}
+
+void Mesh::buildLods(const char *path)
+{
+    auto start = std::chrono::steady_clock::now();
+    CacheStatistics before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+    
+    // Each level is simplified from the one before to about half its triangles
+    std::vector<std::vector<unsigned int>> levels(1, indices);
+    std::vector<float> errors(1, 0.0f);
+    while (levels.size() < maxMeshLods)
+    {
+        const std::vector<unsigned int> &previous = levels.back();
+        std::vector<unsigned int> simplified;
+        float error = simplifyMesh(vertices, previous.data(), previous.size(), previous.size() / 2, simplified);
+        
+        // Stop once locked seams and borders stall the simplifier
+        if (simplified.empty() || simplified.size() > previous.size() * 3 / 4)
+        {
+            break;
+        }
+        errors.push_back(std::max(errors.back(), error));
+        levels.push_back(std::move(simplified));
+    }
+    
+    // Reorder every level for the post-transform cache and overdraw, then the
+    // shared vertices for fetch in the order the full detail level uses them
+    indices.clear();
+    lods.clear();
+    meshlets.clear();
+    size_t clusterCount = 0;
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        std::vector<unsigned int> &level = levels[i];
+        std::vector<size_t> clusters = optimizeVertexCache(level.data(), level.size(), vertices.size());
+        optimizeOverdraw(level.data(), level.size(), vertices, clusters);
+        clusterCount += i == 0 ? clusters.size() : 0;
+        
+        // Split the level into meshlets over its final triangle order
+        size_t meshletOffset = meshlets.size();
+        buildMeshlets(vertices, level.data(), level.size(), static_cast<uint32_t>(indices.size()), meshlets);
+        lods.push_back(MeshLod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.size()),
+                                static_cast<uint32_t>(meshletOffset),
+                                static_cast<uint32_t>(meshlets.size() - meshletOffset), errors[i] });
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
+    optimizeVertexFetch(vertices, indices.data(), indices.size());
+    CacheStatistics after = analyzeVertexCache(indices.data(), lods[0].indexCount, vertices.size());
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("Optimised %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu clusters\n",
+           path, before.acmr, after.acmr, before.atvr, after.atvr, clusterCount);
+    printf("Built %zu LODs for %s in %.2f ms:", lods.size(), path, elapsed.count());
+    for (const MeshLod &lod : lods)
+    {
+        printf(" %u triangles in %u meshlets (error %.3g)", lod.indexCount / 3, lod.meshletCount, lod.error);
+    }
+    printf("\n");
+}
+
+bool Mesh::loadObj(const char *path,
+                    std::vector<Vertex> &outVertices,
+                    std::vector<unsigned int> &outIndices)
+{
+    
+    printf("Loading file %s\n", path);
+    auto start = std::chrono::steady_clock::now();
+    
+    ObjData obj;
+    if (!parseObj(path, obj))
+    {
+        return false;
+    }
+    
+    // Weld triangle corners with identical attributes into one vertex, using an
+    // open addressing hash table of vertex indices
+    size_t tableSize = 1;
+    while (tableSize < obj.corners.size() * 2)
+    {
+        tableSize <<= 1;
+    }
+    const unsigned int emptySlot = 0xFFFFFFFFu;
+    std::vector<unsigned int> vertexTable(tableSize, emptySlot);
+    outVertices.reserve(obj.positions.size());
+    outIndices.resize(obj.corners.size());
+    for (size_t i = 0; i < obj.corners.size(); i++)
+    {
+        // Get the attributes
+        const ObjCorner &corner = obj.corners[i];
+        VertexKey key;
+        key.position = obj.positions[corner.position];
+        key.uv       = corner.uv     != ObjData::missing ? obj.uvs[corner.uv]         : glm::vec2(0.0f);
+        key.normal   = corner.normal != ObjData::missing ? obj.normals[corner.normal] : glm::vec3(0.0f);
+        
+        size_t slot = hashVertex(key) & (tableSize - 1);
+        while (vertexTable[slot] != emptySlot)
+        {
+            unsigned int index = vertexTable[slot];
+            const Vertex &vertex = outVertices[index];
+            if (sameBits(vertex.position, key.position) && sameBits(vertex.uv, key.uv) &&
+                sameBits(vertex.normal, key.normal))
+            {
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        
+        // Copy the attributes to the buffers the first time they are seen
+        if (vertexTable[slot] == emptySlot)
+        {
+            vertexTable[slot] = static_cast<unsigned int>(outVertices.size());
+            Vertex vertex = {};
+            vertex.position = key.position;
+            vertex.uv       = key.uv;
+            vertex.normal   = key.normal;
+            outVertices.push_back(vertex);
+        }
+        outIndices[i] = vertexTable[slot];
+    }
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("Loaded %s: %zu triangles in %.2f ms\n", path, outIndices.size() / 3, elapsed.count());
+    
+    return true;
+}
 
-Mesh::Mesh(vector<Vertex> vertices,
-     vector<unsigned int> indices,
-     vector <Texture> textures)
+bool Mesh::loadGlb(const char *path, const GlbFile &glb,
+                    std::vector<Vertex> &outVertices,
+                    std::vector<unsigned int> &outIndices)
 {
-    this->vertices = vertices;
-    this->indices  = indices;
-    this->textures = textures;
+    printf("Loading file %s\n", path);
+    auto start = std::chrono::steady_clock::now();
+    if (!glb.isValid())
+    {
+        printf("No triangle meshes in %s\n", path);
+        return false;
+    }
+    
+    // glTF vertices are already unique, so each primitive is appended with its node
+    // transform baked in and its indices offset past the vertices before it. The copy
+    // feeds the optimiser, LODs and the cooked mesh, so it only runs when the cache is cold
+    for (const GlbPrimitive &primitive : glb.primitives())
+    {
+        size_t base = outVertices.size();
+        size_t count = primitive.positions.count;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(primitive.transform)));
+        outVertices.resize(base + count);
+        for (size_t i = 0; i < count; i++)
+        {
+            Vertex &vertex = outVertices[base + i];
+            vertex = Vertex();
+            glm::vec3 position(primitive.positions.component(i, 0), primitive.positions.component(i, 1),
+                               primitive.positions.component(i, 2));
+            vertex.position = glm::vec3(primitive.transform * glm::vec4(position, 1.0f));
+            if (primitive.normals.isValid())
+            {
+                glm::vec3 normal(primitive.normals.component(i, 0), primitive.normals.component(i, 1),
+                                 primitive.normals.component(i, 2));
+                vertex.normal = glm::normalize(normalMatrix * normal);
+            }
+            if (primitive.uvs.isValid())
+            {
+                // glTF puts the uv origin at the top left, the rest of the renderer at the bottom left
+                vertex.uv = glm::vec2(primitive.uvs.component(i, 0), 1.0f - primitive.uvs.component(i, 1));
+            }
+        }
+        
+        // Triangles with out of range indices are dropped
+        size_t indexCount = primitive.indices.isValid() ? primitive.indices.count : count;
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            uint32_t triangle[3];
+            for (int corner = 0; corner < 3; corner++)
+            {
+                triangle[corner] = primitive.indices.isValid() ? primitive.indices.index(i + corner)
+                                                               : static_cast<uint32_t>(i + corner);
+            }
+            if (triangle[0] < count && triangle[1] < count && triangle[2] < count)
+            {
+                for (uint32_t index : triangle)
+                {
+                    outIndices.push_back(static_cast<unsigned int>(base + index));
+                }
+            }
+        }
+    }
+    
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    printf("Loaded %s: %zu triangles, %zu primitives in %.2f ms\n", path, outIndices.size() / 3,
+           glb.primitives().size(), elapsed.count());
     
-//    setupMesh();
+    return !outIndices.empty();
+}
+
+void Mesh::calculateNormals() {
+    // Accumulate each triangle's tangent frame onto its (shared) vertices
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        Vertex &v0 = vertices[indices[i + 0]];
+        Vertex &v1 = vertices[indices[i + 1]];
+        Vertex &v2 = vertices[indices[i + 2]];
+        glm::vec3 e1 = v1.position - v0.position;
+        glm::vec3 e2 = v2.position - v1.position;
+
+        glm::vec2 currDelta = { v1.uv.x - v0.uv.x, v1.uv.y - v0.uv.y };
+        glm::vec2 nextDelta = { v2.uv.x - v1.uv.x, v2.uv.y - v1.uv.y };
+
+        float det = currDelta.x * nextDelta.y - nextDelta.x * currDelta.y;
+        if (det == 0.0f) {
+            // Degenerate uvs would spread NaNs to every shared vertex
+            continue;
+        }
+        float denom = 1.0f / det;
+        glm::vec3 tangent = (nextDelta.y * e1 - currDelta.y * e2) * denom;
+        glm::vec3 bitangent = (currDelta.x * e2 - nextDelta.x * e1) * denom;
+
+        v0.tangent += tangent;
+        v1.tangent += tangent;
+        v2.tangent += tangent;
+        v0.bitangent += bitangent;
+        v1.bitangent += bitangent;
+        v2.bitangent += bitangent;
+    }
 }
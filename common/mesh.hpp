@@ -1,43 +1,219 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
 
-using namespace std;
+#include "shader_program.hpp"
+#include "vertex_layout.hpp"
 
-struct vec3 {
-    float x, y, z;
+// Interleaved vertex, members in shader location order
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
 };
 
-struct vec2
+using VertexFormat = VertexLayout<
+    VertexAttribute<glm::vec3, 3, GL_FLOAT>,  // position
+    VertexAttribute<glm::vec2, 2, GL_FLOAT>,  // uv
+    VertexAttribute<glm::vec3, 3, GL_FLOAT>,  // normal
+    VertexAttribute<glm::vec3, 3, GL_FLOAT>,  // tangent
+    VertexAttribute<glm::vec3, 3, GL_FLOAT>>; // bitangent
+
+static_assert(VertexFormat::stride == sizeof(Vertex), "VertexFormat does not match Vertex");
+static_assert(VertexFormat::offset(1) == offsetof(Vertex, uv) &&
+              VertexFormat::offset(2) == offsetof(Vertex, normal) &&
+              VertexFormat::offset(3) == offsetof(Vertex, tangent) &&
+              VertexFormat::offset(4) == offsetof(Vertex, bitangent), "VertexFormat does not match Vertex");
+
+// Optional compressed vertex formats
+enum VertexCompression { VERTEX_FLOAT, VERTEX_PACKED, VERTEX_QUANTIZED };
+
+// Half float uvs, octahedral normal and a 2_10_10_10 tangent whose w holds the
+// bitangent handedness
+struct PackedVertex
 {
-    float x, y;
+    glm::vec3 position;
+    uint16_t  uv[2];
+    int16_t   normal[2];
+    uint32_t  tangent;
 };
 
-struct Vertex
+// PackedVertex with positions quantised to 16 bits across the mesh bounds
+struct QuantizedVertex
+{
+    uint16_t position[4]; // w is padding to keep the next attribute aligned
+    uint16_t uv[2];
+    int16_t  normal[2];
+    uint32_t tangent;
+};
+
+using PackedVertexFormat = VertexLayout<
+    VertexAttribute<glm::vec3,   3, GL_FLOAT>,
+    VertexAttribute<uint16_t[2], 2, GL_HALF_FLOAT>,
+    VertexAttribute<int16_t[2],  2, GL_SHORT, GL_TRUE>,
+    VertexAttribute<uint32_t,    4, GL_INT_2_10_10_10_REV, GL_TRUE>>;
+
+using QuantizedVertexFormat = VertexLayout<
+    VertexAttribute<uint16_t[4], 3, GL_UNSIGNED_SHORT, GL_TRUE>,
+    VertexAttribute<uint16_t[2], 2, GL_HALF_FLOAT>,
+    VertexAttribute<int16_t[2],  2, GL_SHORT, GL_TRUE>,
+    VertexAttribute<uint32_t,    4, GL_INT_2_10_10_10_REV, GL_TRUE>>;
+
+static_assert(PackedVertexFormat::stride == sizeof(PackedVertex), "PackedVertexFormat does not match PackedVertex");
+static_assert(QuantizedVertexFormat::stride == sizeof(QuantizedVertex), "QuantizedVertexFormat does not match QuantizedVertex");
+
+// One level of detail, a range of a shared index buffer split into meshlets, and
+// its geometric error in object space units
+struct MeshLod
 {
-    vec3 position;
-    vec3 normal;
-    vec2 uv;
-    vec3 tangent;
-    vec3 bitangent;
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+    float    error;
 };
 
-struct Texture
+// Cluster of consecutive triangles, culled as a whole against the frustum and by
+// its normal cone before the draw is issued
+struct Meshlet
 {
-    unsigned int id;
-    string type;
-    string path;
+    uint32_t  indexOffset;
+    uint32_t  indexCount;
+    glm::vec3 centre;
+    float     radius;
+    glm::vec3 coneAxis;
+    float     coneCutoff; // sine of the cone spread, 1 when it never faces away
 };
 
+// Meshlet limits, sized to a warp friendly vertex count
+const unsigned int meshletMaxVertices = 64;
+const unsigned int meshletMaxTriangles = 124;
+
+// Full detail level plus up to three simplified ones
+const unsigned int maxMeshLods = 4;
+
+inline size_t vertexSize(VertexCompression compression) {
+    switch (compression) {
+        case VERTEX_PACKED:    return sizeof(PackedVertex);
+        case VERTEX_QUANTIZED: return sizeof(QuantizedVertex);
+        default:               return sizeof(Vertex);
+    }
+}
+
+struct MeshView;
+class CookedMesh;
+class GlbFile;
+
+// Geometry of one source file on the GPU, shared by every Model drawing it
 class Mesh
 {
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
-    vector<Texture>      textures;
-    unsigned int VAO;
-    
-    // Constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices,
-         vector <Texture> textures);
+public:
+    // Source geometry, only held while the mesh is built. It is released once the
+    // GPU has it, readGeometry reads it back for consumers such as collision
+    std::vector<Vertex>       vertices;
+    std::vector<unsigned int> indices;
+    
+    // Levels of detail from full to coarsest, their meshlets, and the object space
+    // bounds they share
+    std::vector<MeshLod>      lods;
+    std::vector<Meshlet>      meshlets;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    
+    // Texture repeats one object space unit spans on average, 0 without uvs
+    float uvDensity = 0.0f;
+    
+    // Buffer memory and load time, reported when a duplicate load is avoided
+    size_t gpuBytes = 0;
+    double loadMilliseconds = 0.0;
+    
+    // When a draw last used the mesh, on the ResidencyManager clock
+    double lastDrawn = 0.0;
+    
+    // Constructor for .obj and .glb files, optionally storing vertices in a compressed format.
+    // Without uploadNow only CPU work is done, so it can run off the context thread
+    Mesh(const char *path, VertexCompression compression = VERTEX_FLOAT, bool uploadNow = true);
+    ~Mesh();
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    
+    // Draw a level of detail with the rest of the block filled in by the caller
+    void draw(DrawBlock &block, size_t lod = 0);
+    
+    // Draw only the meshlets inside the frustum that face the camera
+    void draw(DrawBlock &block, size_t lod, const glm::mat4 &modelView, const glm::mat4 &projection);
+    
+    // Creates the GL buffers from the data the constructor prepared, on the context thread
+    void upload();
+    
+    const std::string& path() const { return sourcePath; }
+    
+    // Whether the buffers are on the GPU. An evicted mesh keeps its LOD table and bounds,
+    // and is restored from its cooked file by the next draw
+    bool isResident() const { return VAO != 0; }
+    void evict();
+    
+    // Object space positions and the triangles of the full detail level, read back from
+    // the cooked mesh. False when the source cannot be loaded
+    bool readGeometry(std::vector<glm::vec3> &positions, std::vector<unsigned int> &triangles) const;
+    
+    void deleteBuffers();
+    
+private:
+    
+    // Array buffers
+    unsigned int VAO = 0;
+    unsigned int vertexBuffer = 0;
+    unsigned int indexBuffer = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    
+    // Ranges of the visible meshlets, reused between draws
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    
+    // Source file and vertex format, and the bounds quantised positions are decoded against
+    std::string sourcePath;
+    VertexCompression compression = VERTEX_FLOAT;
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    
+    // GPU-ready data waiting for upload, pointing into the cooked file or the staging vectors
+    std::unique_ptr<MeshView> staged;
+    std::unique_ptr<CookedMesh> cooked;
+    std::vector<unsigned short> stagedIndices;
+    std::vector<unsigned char> stagedVertices;
+    
+    // Load .obj file method
+    bool loadObj(const char *path,
+                 std::vector<Vertex> &inVertices,
+                 std::vector<unsigned int> &inIndices);
+    
+    // Load .glb file method
+    bool loadGlb(const char *path, const GlbFile &glb,
+                 std::vector<Vertex> &inVertices,
+                 std::vector<unsigned int> &inIndices);
+    
+    // Simplify into a LOD chain and optimise every level for the GPU
+    void buildLods(const char *path);
+    
+    // Tell the vertex shader how to decode the vertex format, and send the block for the draw
+    bool bindDrawBlock(DrawBlock &block);
+    
+    // Setup buffers
+    void setupBuffers(const MeshView &mesh);
+    
+    // Uploads an evicted mesh again before it is drawn
+    bool restore();
+
+    void calculateNormals();
 };
@@ -0,0 +1,585 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+namespace {
+
+const size_t minClusterTriangles = 64;
+
+// Triangles using each vertex, stored as one flat list with per-vertex offsets
+struct Adjacency
+{
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> counts;
+    std::vector<unsigned int> triangles;
+};
+
+void buildAdjacency(const unsigned int* indices, size_t indexCount, size_t vertexCount, Adjacency &adjacency) {
+    adjacency.counts.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacency.counts[indices[i]]++;
+    }
+    adjacency.offsets.resize(vertexCount);
+    unsigned int offset = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacency.offsets[v] = offset;
+        offset += adjacency.counts[v];
+    }
+    adjacency.triangles.resize(indexCount);
+    std::vector<unsigned int> fill(adjacency.offsets);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacency.triangles[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+}
+
+// Symmetric 4x4 error quadric of area weighted planes
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::vec3 &normal, float distance, float area) {
+        double x = normal.x, y = normal.y, z = normal.z, d = distance;
+        a00 += area * x * x; a01 += area * x * y; a02 += area * x * z;
+        a11 += area * y * y; a12 += area * y * z; a22 += area * z * z;
+        b0 += area * x * d; b1 += area * y * d; b2 += area * z * d;
+        c += area * d * d;
+        weight += area;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Area weighted sum of squared distances to the planes
+    double evaluate(const glm::vec3 &point) const {
+        double x = point.x, y = point.y, z = point.z;
+        double result = a00 * x * x + a11 * y * y + a22 * z * z +
+                        2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                        2 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(result, 0.0);
+    }
+};
+
+// Mean squared distance of the planes of both vertices from the position of the kept one
+double collapseCost(const Quadric &from, const Quadric &to, const glm::vec3 &position) {
+    double weight = from.weight + to.weight;
+    return weight > 0 ? (from.evaluate(position) + to.evaluate(position)) / weight : 0;
+}
+
+bool samePosition(const glm::vec3 &a, const glm::vec3 &b) {
+    return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+}
+
+bool lessPosition(const glm::vec3 &a, const glm::vec3 &b) {
+    return memcmp(&a, &b, sizeof(glm::vec3)) < 0;
+}
+
+// Collapse of every vertex at one position onto a neighbouring position
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+// Below this cosine between a triangle's normal before and after a collapse, it counts as flipped
+const float minFlipCosine = 0.2f;
+
+}
+
+CacheStatistics analyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                   unsigned int cacheSize) {
+    CacheStatistics statistics = { 0.0f, 0.0f };
+    if (indexCount == 0 || vertexCount == 0) {
+        return statistics;
+    }
+
+    // A vertex is cached while fewer than cacheSize misses have happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int vertex = indices[i];
+        if (time - loadedAt[vertex] > cacheSize) {
+            loadedAt[vertex] = time++;
+            misses++;
+        }
+    }
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+    return statistics;
+}
+
+std::vector<size_t> optimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                        unsigned int cacheSize) {
+    std::vector<size_t> clusters;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    Adjacency adjacency;
+    buildAdjacency(indices, indexCount, vertexCount, adjacency);
+
+    std::vector<unsigned int> live(adjacency.counts);
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    int fanning = -1;
+    bool jumped = true;
+
+    // Start from the first used vertex
+    while (cursor < vertexCount && live[cursor] == 0) {
+        cursor++;
+    }
+    fanning = cursor < vertexCount ? static_cast<int>(cursor) : -1;
+
+    while (fanning >= 0) {
+        // Tiny clusters would let the overdraw sort scatter triangles and undo the cache order
+        if (jumped && (clusters.empty() || output.size() / 3 - clusters.back() >= minClusterTriangles)) {
+            clusters.push_back(output.size() / 3);
+        }
+        jumped = false;
+
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        unsigned int begin = adjacency.offsets[fanning];
+        for (unsigned int k = begin; k < begin + adjacency.counts[fanning]; k++) {
+            unsigned int triangle = adjacency.triangles[k];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+        // Prefer the oldest candidate that will still be cached once its own fan is emitted
+        int best = -1;
+        size_t bestPriority = 0;
+        for (unsigned int vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+            size_t priority = 0;
+            size_t age = time - cacheTime[vertex];
+            if (age + 2 * live[vertex] <= cacheSize) {
+                priority = age;
+            }
+            if (priority > bestPriority) {
+                best = static_cast<int>(vertex);
+                bestPriority = priority;
+            }
+        }
+
+        if (best < 0) {
+            // Dead end: back up through recently used vertices, then scan for any left
+            while (!deadEnd.empty() && best < 0) {
+                unsigned int vertex = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[vertex] > 0) {
+                    best = static_cast<int>(vertex);
+                }
+            }
+            while (best < 0 && cursor < vertexCount) {
+                if (live[cursor] > 0) {
+                    best = static_cast<int>(cursor);
+                }
+                cursor++;
+            }
+            jumped = true;
+        }
+        fanning = best;
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+    return clusters;
+}
+
+void optimizeOverdraw(unsigned int *indices, size_t indexCount, const std::vector<Vertex> &vertices,
+                      const std::vector<size_t> &clusters) {
+    size_t triangleCount = indexCount / 3;
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // Area weighted centroid and normal of each cluster, and of the whole mesh
+    struct Cluster
+    {
+        size_t begin;
+        size_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    std::vector<glm::vec3> centroids(clusters.size());
+    std::vector<glm::vec3> normals(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        sorted[c].begin = clusters[c];
+        sorted[c].end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = sorted[c].begin; t < sorted[c].end; t++) {
+            const glm::vec3 &a = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3 &b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 cross = glm::cross(b - a, p - a);
+            float triangleArea = 0.5f * glm::length(cross);
+            centroid += (a + b + p) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : vertices[indices[sorted[c].begin * 3]].position;
+        normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+    for (size_t c = 0; c < clusters.size(); c++) {
+        sorted[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+    for (const Cluster &cluster : sorted) {
+        output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void buildMeshlets(const std::vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                   uint32_t indexOffset, std::vector<Meshlet> &out) {
+    // Vertices seen by the meshlet being filled are stamped with its number
+    std::vector<size_t> stamp(vertices.size(), 0);
+    size_t meshletNumber = 1;
+    size_t begin = 0;
+    unsigned int uniqueVertices = 0;
+
+    auto finish = [&](size_t end) {
+        Meshlet meshlet;
+        meshlet.indexOffset = static_cast<uint32_t>(indexOffset + begin);
+        meshlet.indexCount = static_cast<uint32_t>(end - begin);
+
+        // Bounding sphere around the vertex centroid
+        glm::vec3 centre(0.0f);
+        for (size_t i = begin; i < end; i++) {
+            centre += vertices[indices[i]].position;
+        }
+        centre /= static_cast<float>(end - begin);
+        float radius = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            radius = std::max(radius, glm::length(vertices[indices[i]].position - centre));
+        }
+
+        // Cone around the average face normal, wide enough for every face
+        std::vector<glm::vec3> normals;
+        glm::vec3 axis(0.0f);
+        for (size_t i = begin; i + 2 < end; i += 3) {
+            const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+            glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                axis += normal / length;
+            }
+        }
+        float minDot = 1.0f;
+        if (glm::length(axis) > 0.0f) {
+            axis = glm::normalize(axis);
+            for (const glm::vec3 &normal : normals) {
+                minDot = std::min(minDot, glm::dot(axis, normal));
+            }
+        } else {
+            minDot = -1.0f;
+        }
+
+        meshlet.centre = centre;
+        meshlet.radius = radius;
+        meshlet.coneAxis = axis;
+        // A spread of 90 degrees or more always has a face towards the camera
+        meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+        out.push_back(meshlet);
+
+        begin = end;
+        uniqueVertices = 0;
+        meshletNumber++;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        unsigned int newVertices = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            newVertices += stamp[indices[i + corner]] != meshletNumber;
+        }
+        if (uniqueVertices + newVertices > meshletMaxVertices || (i - begin) / 3 >= meshletMaxTriangles) {
+            finish(i);
+        }
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = indices[i + corner];
+            if (stamp[vertex] != meshletNumber) {
+                stamp[vertex] = meshletNumber;
+                uniqueVertices++;
+            }
+        }
+    }
+    if (begin < indexCount) {
+        finish(indexCount - indexCount % 3);
+    }
+}
+
+bool cullMeshlet(const Meshlet &meshlet, const glm::vec4 planes[6], const glm::vec3 &camera) {
+    for (int i = 0; i < 6; i++) {
+        if (glm::dot(glm::vec3(planes[i]), meshlet.centre) + planes[i].w < -meshlet.radius) {
+            return true;
+        }
+    }
+    // Every face points away when the view direction stays inside the cone's back side
+    glm::vec3 toCentre = meshlet.centre - camera;
+    return glm::dot(toCentre, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCentre) + meshlet.radius;
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, unsigned int *indices, size_t indexCount) {
+    const unsigned int unused = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int &index = remap[indices[i]];
+        if (index == unused) {
+            index = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = index;
+    }
+    // Vertices no triangle references are dropped
+    vertices.swap(reordered);
+}
+
+float simplifyMesh(const std::vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                   size_t targetIndexCount, std::vector<unsigned int> &out) {
+    out.assign(indices, indices + indexCount);
+    size_t vertexCount = vertices.size();
+    if (indexCount <= targetIndexCount || vertexCount == 0) {
+        return 0.0f;
+    }
+
+    // Vertices split by a uv or normal seam share a position. Each position is one
+    // group, so both sides of a seam share a quadric and collapse together
+    std::vector<unsigned int> wedges(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        wedges[v] = static_cast<unsigned int>(v);
+    }
+    std::sort(wedges.begin(), wedges.end(), [&](unsigned int a, unsigned int b) {
+        return lessPosition(vertices[a].position, vertices[b].position);
+    });
+    std::vector<unsigned int> group(vertexCount);
+    std::vector<unsigned int> groupStart;
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (i == 0 || !samePosition(vertices[wedges[i - 1]].position, vertices[wedges[i]].position)) {
+            groupStart.push_back(static_cast<unsigned int>(i));
+        }
+        group[wedges[i]] = static_cast<unsigned int>(groupStart.size() - 1);
+    }
+    size_t groupCount = groupStart.size();
+    groupStart.push_back(static_cast<unsigned int>(vertexCount));
+
+    std::vector<Quadric> quadrics(groupCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f) {
+            continue;
+        }
+        normal /= length;
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[group[indices[i + corner]]].addPlane(normal, -glm::dot(normal, p0), 0.5f * length);
+        }
+    }
+
+    // Positions on an open border are locked, an edge used by one triangle has
+    // nothing to fold onto
+    Adjacency adjacency;
+    buildAdjacency(indices, indexCount, vertexCount, adjacency);
+    std::vector<bool> locked(groupCount, false);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int a = group[indices[i + corner]];
+            unsigned int b = group[indices[i + (corner + 1) % 3]];
+            unsigned int shared = 0;
+            for (unsigned int w = groupStart[a]; w < groupStart[a + 1]; w++) {
+                unsigned int wedge = wedges[w];
+                for (unsigned int k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge] + adjacency.counts[wedge]; k++) {
+                    const unsigned int *triangle = indices + adjacency.triangles[k] * 3;
+                    shared += group[triangle[0]] == b || group[triangle[1]] == b || group[triangle[2]] == b;
+                }
+            }
+            if (shared < 2) {
+                locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> partner(vertexCount);
+    std::vector<bool> touched(groupCount);
+    std::vector<Collapse> collapses;
+    double maxCost = 0.0;
+
+    // Each pass collapses the cheapest independent edges, then rebuilds the index buffer
+    while (out.size() > targetIndexCount) {
+        buildAdjacency(out.data(), out.size(), vertexCount, adjacency);
+
+        collapses.clear();
+        for (size_t i = 0; i < out.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int a = group[out[i + corner]];
+                unsigned int b = group[out[i + (corner + 1) % 3]];
+                // Interior edges appear once in each direction, only look at one of them
+                if (a > b || (locked[a] && locked[b])) {
+                    continue;
+                }
+                const glm::vec3 &positionA = vertices[wedges[groupStart[a]]].position;
+                const glm::vec3 &positionB = vertices[wedges[groupStart[b]]].position;
+                double costAB = locked[a] ? INFINITY : collapseCost(quadrics[a], quadrics[b], positionB);
+                double costBA = locked[b] ? INFINITY : collapseCost(quadrics[b], quadrics[a], positionA);
+                collapses.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost;
+        });
+
+        // Each collapse removes about two triangles
+        size_t collapseBudget = (out.size() - targetIndexCount) / 6 + 1;
+        size_t collapsed = 0;
+        for (size_t v = 0; v < vertexCount; v++) {
+            remap[v] = static_cast<unsigned int>(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+        for (const Collapse &collapse : collapses) {
+            if (collapsed >= collapseBudget) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Every wedge must fold onto the one wedge of the target it shares an edge
+            // with, so seams only collapse along themselves and stay closed
+            bool valid = true;
+            for (unsigned int w = groupStart[collapse.from]; w < groupStart[collapse.from + 1] && valid; w++) {
+                unsigned int wedge = wedges[w];
+                unsigned int found = ~0u;
+                for (unsigned int k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge] + adjacency.counts[wedge]; k++) {
+                    const unsigned int *triangle = &out[adjacency.triangles[k] * 3];
+                    for (int corner = 0; corner < 3; corner++) {
+                        if (group[triangle[corner]] != collapse.to) {
+                            continue;
+                        }
+                        valid = valid && (found == ~0u || found == triangle[corner]);
+                        found = triangle[corner];
+                    }
+                }
+                // Wedges no longer referenced by any triangle can go anywhere
+                valid = valid && (found != ~0u || adjacency.counts[wedge] == 0);
+                partner[wedge] = found;
+            }
+            if (!valid) {
+                continue;
+            }
+
+            // Reject collapses that would fold a surrounding triangle over
+            const glm::vec3 &target = vertices[wedges[groupStart[collapse.to]]].position;
+            bool flips = false;
+            for (unsigned int w = groupStart[collapse.from]; w < groupStart[collapse.from + 1] && !flips; w++) {
+                unsigned int wedge = wedges[w];
+                for (unsigned int k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge] + adjacency.counts[wedge] && !flips; k++) {
+                    const unsigned int *triangle = &out[adjacency.triangles[k] * 3];
+                    if (group[triangle[0]] == collapse.to || group[triangle[1]] == collapse.to ||
+                        group[triangle[2]] == collapse.to) {
+                        continue;
+                    }
+                    glm::vec3 before[3], after[3];
+                    for (int corner = 0; corner < 3; corner++) {
+                        before[corner] = vertices[triangle[corner]].position;
+                        after[corner] = triangle[corner] == wedge ? target : before[corner];
+                    }
+                    glm::vec3 oldNormal = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::vec3 newNormal = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    float lengths = glm::length(oldNormal) * glm::length(newNormal);
+                    flips = glm::dot(oldNormal, newNormal) <= minFlipCosine * lengths;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            // The one-ring keeps its positions for the rest of the pass, so later flip tests stay exact
+            for (unsigned int w = groupStart[collapse.from]; w < groupStart[collapse.from + 1]; w++) {
+                unsigned int wedge = wedges[w];
+                for (unsigned int k = adjacency.offsets[wedge]; k < adjacency.offsets[wedge] + adjacency.counts[wedge]; k++) {
+                    const unsigned int *triangle = &out[adjacency.triangles[k] * 3];
+                    for (int corner = 0; corner < 3; corner++) {
+                        touched[group[triangle[corner]]] = true;
+                    }
+                }
+                if (partner[wedge] != ~0u) {
+                    remap[wedge] = partner[wedge];
+                }
+            }
+            quadrics[collapse.to] += quadrics[collapse.from];
+            maxCost = std::max(maxCost, collapse.cost);
+            collapsed++;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        size_t written = 0;
+        for (size_t i = 0; i < out.size(); i += 3) {
+            unsigned int a = remap[out[i + 0]], b = remap[out[i + 1]], c = remap[out[i + 2]];
+            if (a != b && b != c && a != c) {
+                out[written++] = a;
+                out[written++] = b;
+                out[written++] = c;
+            }
+        }
+        out.resize(written);
+    }
+    return static_cast<float>(std::sqrt(maxCost));
+}
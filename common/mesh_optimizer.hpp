@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh.hpp"
+
+// Post-transform cache efficiency of an index buffer, simulated with a FIFO cache
+struct CacheStatistics
+{
+    float acmr; // transformed vertices per triangle
+    float atvr; // transformed vertices per unique vertex
+};
+
+// Entries in the simulated post-transform cache
+const unsigned int vertexCacheSize = 16;
+
+CacheStatistics analyzeVertexCache(const unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                   unsigned int cacheSize = vertexCacheSize);
+
+// Reorders triangles for vertex cache locality (Tipsify, Sander et al. 2007) and
+// returns the first triangle of each locally connected cluster it emitted
+std::vector<size_t> optimizeVertexCache(unsigned int *indices, size_t indexCount, size_t vertexCount,
+                                        unsigned int cacheSize = vertexCacheSize);
+
+// Sorts the clusters so outward facing ones on the hull of the mesh draw first,
+// letting the depth test reject more of the fragments behind them
+void optimizeOverdraw(unsigned int *indices, size_t indexCount, const std::vector<Vertex> &vertices,
+                      const std::vector<size_t> &clusters);
+
+// Renumbers vertices in order of first use so vertex fetch walks memory linearly
+void optimizeVertexFetch(std::vector<Vertex> &vertices, unsigned int *indices, size_t indexCount);
+
+// Splits consecutive triangles into meshlets with bounding spheres and normal cones,
+// index offsets start at indexOffset
+void buildMeshlets(const std::vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                   uint32_t indexOffset, std::vector<Meshlet> &out);
+
+// True when the meshlet is outside a frustum plane or faces away from the camera;
+// planes and camera are in the same (object) space as the meshlet
+bool cullMeshlet(const Meshlet &meshlet, const glm::vec4 planes[6], const glm::vec3 &camera);
+
+// Quadric error edge collapse (Garland and Heckbert 1997) towards targetIndexCount,
+// collapsing vertices onto existing neighbours so no attributes are interpolated.
+// UV seams and open borders are kept. Returns the largest object space error.
+float simplifyMesh(const std::vector<Vertex> &vertices, const unsigned int *indices, size_t indexCount,
+                   size_t targetIndexCount, std::vector<unsigned int> &out);
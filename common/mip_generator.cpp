@@ -0,0 +1,199 @@
+#include "mip_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+namespace {
+
+const int linearSteps = 65535;
+
+// sRGB transfer function, decoding 8 bit values to linear floats and encoding
+// 16 bit linear values back, fine enough that no dark sRGB value is skipped
+struct SrgbTables {
+    float toLinear[256];
+    unsigned char toSrgb[linearSteps + 1];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            double value = i / 255.0;
+            toLinear[i] = static_cast<float>(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+        }
+        for (int i = 0; i <= linearSteps; i++) {
+            double value = static_cast<double>(i) / linearSteps;
+            double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+            toSrgb[i] = static_cast<unsigned char>(encoded * 255.0 + 0.5);
+        }
+    }
+};
+
+const SrgbTables& srgbTables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// Integer average of each channel, 4 bytes per texel
+void filterLinear(const unsigned char *top, const unsigned char *bottom, int width, int targetWidth, unsigned char *out) {
+    int step = width > 1 ? 4 : 0;
+    int x = 0;
+#ifdef MIP_GENERATOR_SSE2
+    // Four source texels make two target texels, and a full 16 byte load never
+    // reaches past the row because only a single texel wide row is clamped
+    if (width > 1) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16(2);
+        for (; x + 2 <= targetWidth; x += 2) {
+            __m128i upper = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 8 * x));
+            __m128i lower = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 8 * x));
+            __m128i first = _mm_add_epi16(_mm_unpacklo_epi8(upper, zero), _mm_unpacklo_epi8(lower, zero));
+            __m128i second = _mm_add_epi16(_mm_unpackhi_epi8(upper, zero), _mm_unpackhi_epi8(lower, zero));
+            first = _mm_add_epi16(first, _mm_srli_si128(first, 8));
+            second = _mm_add_epi16(second, _mm_srli_si128(second, 8));
+            __m128i average = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(first, second), rounding), 2);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(average, average));
+        }
+    }
+#endif
+    for (; x < targetWidth; x++) {
+        const unsigned char *upper = top + 8 * x, *lower = bottom + 8 * x;
+        for (int c = 0; c < 4; c++) {
+            out[4 * x + c] = static_cast<unsigned char>((upper[c] + upper[c + step] + lower[c] + lower[c + step] + 2) / 4);
+        }
+    }
+}
+
+// Colour averaged as linear light, alpha as it is
+void filterSrgb(const unsigned char *top, const unsigned char *bottom, int width, int targetWidth, unsigned char *out) {
+    const SrgbTables &tables = srgbTables();
+    int step = width > 1 ? 4 : 0;
+    for (int x = 0; x < targetWidth; x++) {
+        const unsigned char *texels[4] = { top + 8 * x, top + 8 * x + step, bottom + 8 * x, bottom + 8 * x + step };
+        int32_t encode[4];
+#ifdef MIP_GENERATOR_SSE2
+        // The sum is scaled to the encode table's range for colour and to 8 bits for alpha
+        const __m128 scale = _mm_setr_ps(linearSteps / 4.0f, linearSteps / 4.0f, linearSteps / 4.0f, 0.25f);
+        __m128 sum = _mm_setzero_ps();
+        for (const unsigned char *texel : texels) {
+            sum = _mm_add_ps(sum, _mm_setr_ps(tables.toLinear[texel[0]], tables.toLinear[texel[1]],
+                                              tables.toLinear[texel[2]], texel[3]));
+        }
+        __m128i rounded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, scale), _mm_set1_ps(0.5f)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(encode), rounded);
+#else
+        for (int c = 0; c < 4; c++) {
+            float sum = 0.0f;
+            for (const unsigned char *texel : texels) {
+                sum += c < 3 ? tables.toLinear[texel[c]] : texel[c];
+            }
+            encode[c] = static_cast<int32_t>(sum * (c < 3 ? linearSteps / 4.0f : 0.25f) + 0.5f);
+        }
+#endif
+        for (int c = 0; c < 3; c++) {
+            out[4 * x + c] = tables.toSrgb[std::min(encode[c], linearSteps)];
+        }
+        out[4 * x + 3] = static_cast<unsigned char>(std::min(encode[3], 255));
+    }
+}
+
+// Normals in rgb averaged and brought back to unit length, alpha averaged as it is
+void filterNormal(const unsigned char *top, const unsigned char *bottom, int width, int targetWidth, unsigned char *out) {
+    int step = width > 1 ? 4 : 0;
+    for (int x = 0; x < targetWidth; x++) {
+        const unsigned char *texels[4] = { top + 8 * x, top + 8 * x + step, bottom + 8 * x, bottom + 8 * x + step };
+#ifdef MIP_GENERATOR_SSE2
+        __m128 sum = _mm_setzero_ps();
+        for (const unsigned char *texel : texels) {
+            int bytes;
+            memcpy(&bytes, texel, 4);
+            __m128i widened = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+            widened = _mm_unpacklo_epi16(widened, _mm_setzero_si128());
+            sum = _mm_add_ps(sum, _mm_cvtepi32_ps(widened));
+        }
+        // Decode the mean to [-1, 1], alpha stays in [0, 255]
+        __m128 normal = _mm_sub_ps(_mm_mul_ps(sum, _mm_setr_ps(1.0f / 510.0f, 1.0f / 510.0f, 1.0f / 510.0f, 0.25f)),
+                                   _mm_setr_ps(1.0f, 1.0f, 1.0f, 0.0f));
+        __m128 squares = _mm_mul_ps(normal, _mm_setr_ps(1.0f, 1.0f, 1.0f, 0.0f));
+        squares = _mm_mul_ps(squares, normal);
+        squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+        squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(1, 0, 3, 2)));
+        float lengthSquared = _mm_cvtss_f32(squares);
+        float alpha = _mm_cvtss_f32(_mm_shuffle_ps(normal, normal, _MM_SHUFFLE(3, 3, 3, 3)));
+        if (lengthSquared < 1e-12f) {
+            // Opposing normals cancel out, so point straight out of the surface
+            normal = _mm_setr_ps(0.0f, 0.0f, 1.0f, alpha);
+        } else {
+            float inverse = 1.0f / std::sqrt(lengthSquared);
+            normal = _mm_mul_ps(normal, _mm_setr_ps(inverse, inverse, inverse, 1.0f));
+        }
+        __m128i encoded = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(normal, _mm_setr_ps(127.5f, 127.5f, 127.5f, 1.0f)),
+                                                      _mm_setr_ps(128.0f, 128.0f, 128.0f, 0.5f)));
+        encoded = _mm_packs_epi32(encoded, encoded);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(encoded, encoded));
+        memcpy(out + 4 * x, &packed, 4);
+#else
+        float normal[4] = {};
+        for (const unsigned char *texel : texels) {
+            for (int c = 0; c < 4; c++) {
+                normal[c] += texel[c];
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            normal[c] = normal[c] / 510.0f - 1.0f;
+        }
+        normal[3] *= 0.25f;
+        float lengthSquared = normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2];
+        if (lengthSquared < 1e-12f) {
+            normal[0] = normal[1] = 0.0f;
+            normal[2] = 1.0f;
+        } else {
+            float inverse = 1.0f / std::sqrt(lengthSquared);
+            for (int c = 0; c < 3; c++) {
+                normal[c] *= inverse;
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            out[4 * x + c] = static_cast<unsigned char>(std::min(std::max(normal[c] * 127.5f + 128.0f, 0.0f), 255.0f));
+        }
+        out[4 * x + 3] = static_cast<unsigned char>(std::min(normal[3] + 0.5f, 255.0f));
+#endif
+    }
+}
+
+}
+
+void downsampleLevel(const unsigned char *source, int width, int height, unsigned char *target, MipFilter filter) {
+    int targetWidth = std::max(1, width / 2), targetHeight = std::max(1, height / 2);
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    for (int y = 0; y < targetHeight; y++) {
+        const unsigned char *top = source + 2 * y * rowBytes;
+        const unsigned char *bottom = height > 1 ? top + rowBytes : top;
+        unsigned char *out = target + static_cast<size_t>(y) * targetWidth * 4;
+        switch (filter) {
+            case MIP_LINEAR: filterLinear(top, bottom, width, targetWidth, out); break;
+            case MIP_SRGB:   filterSrgb(top, bottom, width, targetWidth, out); break;
+            case MIP_NORMAL: filterNormal(top, bottom, width, targetWidth, out); break;
+        }
+    }
+}
+
+void generateMips(const unsigned char *rgba, int width, int height, MipFilter filter,
+                  std::vector<std::vector<unsigned char>> &levels) {
+    // Reserved so earlier levels stay put while later ones are added
+    levels.clear();
+    levels.reserve(32);
+    const unsigned char *source = rgba;
+    while (width > 1 || height > 1) {
+        int targetWidth = std::max(1, width / 2), targetHeight = std::max(1, height / 2);
+        levels.emplace_back(static_cast<size_t>(targetWidth) * targetHeight * 4);
+        downsampleLevel(source, width, height, levels.back().data(), filter);
+        source = levels.back().data();
+        width = targetWidth;
+        height = targetHeight;
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+// How texels are combined when averaging down a level. Colour is averaged as
+// linear light rather than as sRGB values, normals are renormalised
+enum MipFilter { MIP_LINEAR, MIP_SRGB, MIP_NORMAL };
+
+// Next level of 8 bit RGBA texels, half the size and at least 1x1. Each texel is
+// the box filtered 2x2 texels above it, an odd last row or column is repeated
+void downsampleLevel(const unsigned char *source, int width, int height, unsigned char *target, MipFilter filter);
+
+// Every level below the image down to 1x1, smallest last
+void generateMips(const unsigned char *rgba, int width, int height, MipFilter filter,
+                  std::vector<std::vector<unsigned char>> &levels);
@@ -3,308 +3,409 @@
 #include <string>
 #include <cstring>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "model.hpp"
+#include "glb_parser.hpp"
 #include "stb_image.hpp"
+#include "residency_manager.hpp"
+#include "texture_streamer.hpp"
 
-Model::Model(const char *path) : textures(0), vertices(), normals(), uvs()
+namespace {
+
+TextureUsage usageFor(const std::string &type)
 {
-    textures = std::vector<Texture>();
-    // Load object
-    bool res = loadObj(path, vertices, uvs, normals);
-    // Setup buffers
-    calculateNormals();
-    setupBuffers();
+    if (type == "normal")
+        return TEXTURE_NORMAL;
+    else if (type == "specular")
+        return TEXTURE_SPECULAR;
+    return TEXTURE_COLOUR;
 }
 
-void Model::draw(unsigned int &shaderID)
+// Layer of the texture array for a material slot, nullptr when the map needs a texture of its own
+std::shared_ptr<TextureLayer> arrayLayer(const char *path, const std::string &type, const char *packedPath = nullptr)
 {
-    // Send material properties to the shader
-    glUniform1f(glGetUniformLocation(shaderID, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderID, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderID, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderID, "Ns"), Ns);
-    
-    // Bind the textures
-    unsigned int diffuseNum = 0;
-    unsigned int normalNum = 0;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    if (type != "diffuse" && type != "normal" && type != "specular")
+        return nullptr;
+    return TextureArrays::instance().layer(path, usageFor(type), packedPath);
+}
+
+Texture materialTexture(const char *path, const std::string &type, const char *packedPath = nullptr)
+{
+    Texture texture;
+    texture.type = type;
+    texture.usage = usageFor(type);
+    texture.path = path;
+    texture.layer = arrayLayer(path, type, packedPath);
+    if (!texture.layer)
     {
-        // Bind texture
-        std::string name = textures[i].type;
-        glActiveTexture(GL_TEXTURE0 + i);
-        glUniform1i(glGetUniformLocation(shaderID, (name + "Map").c_str()), i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        texture.shared = AssetRegistry::instance().texture(path, usageFor(type));
     }
-    
-    // Draw the triangles
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<unsigned int>(vertices.size()));
-    glBindVertexArray(0);
+    return texture;
 }
 
-void Model::setupBuffers()
+// Maps of a material. The specular map is packed into the alpha of the diffuse
+// layer, saving the shader a sampler and a fetch, unless the diffuse map needs
+// a texture of its own
+std::vector<Texture> materialTextures(const std::vector<TextureSource> &sources)
 {
-    // Create and bind the Vertex Array Object (VAO)
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    
-    // Create Vertex Buffer Object
-    glGenBuffers(1, &vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), &vertices[0], GL_STATIC_DRAW);
-    
-    // Create uv buffer
-    glGenBuffers(1, &uvBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2), &uvs[0], GL_STATIC_DRAW);
-    
-    // Create normal buffer
-    glGenBuffers(1, &normalBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
-    
-    glGenBuffers(1, &tangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, tangents.size() * sizeof(glm::vec3), &tangents[0], GL_STATIC_DRAW);
+    const TextureSource* specular = nullptr;
+    for (const TextureSource &source : sources)
+    {
+        if (source.type == "specular")
+            specular = &source;
+    }
+    std::vector<Texture> textures;
+    bool packed = false;
+    for (const TextureSource &source : sources)
+    {
+        if (source.type == "diffuse" && specular)
+        {
+            textures.push_back(materialTexture(source.path.c_str(), source.type, specular->path.c_str()));
+            packed = textures.back().layer != nullptr;
+        }
+    }
+    for (const TextureSource &source : sources)
+    {
+        if (source.type == "diffuse" && specular)
+            continue;
+        if (&source == specular && packed)
+        {
+            Texture texture;
+            texture.type = source.type;
+            texture.usage = usageFor(source.type);
+            texture.path = source.path;
+            texture.packed = true;
+            textures.push_back(texture);
+            continue;
+        }
+        textures.push_back(materialTexture(source.path.c_str(), source.type));
+    }
+    return textures;
+}
 
-    glGenBuffers(1, &bitangentBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glBufferData(GL_ARRAY_BUFFER, bitangents.size() * sizeof(glm::vec3), &bitangents[0], GL_STATIC_DRAW);
+}
+
+Model::Model(const char *path, VertexCompression compression) : textures()
+{
+    mesh = AssetRegistry::instance().mesh(path, compression);
+    if (isGlbPath(path))
+    {
+        loadGlbTextures(path);
+    }
+}
 
-    // Bind the vertex buffer
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+Model::Model(std::shared_ptr<Mesh> mesh) : mesh(std::move(mesh)), textures()
+{
+}
+
+AssetHandle<std::shared_ptr<Model>> Model::loadAsync(const char *path, VertexCompression compression,
+                                                     const std::vector<TextureSource> &sources)
+{
+    AssetHandle<std::shared_ptr<Mesh>> mesh = AssetRegistry::instance().meshAsync(path, compression);
     
-    // Bind the uv buffer
-    glEnableVertexAttribArray(1);
-    glBindBuffer(GL_ARRAY_BUFFER, uvBuffer);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    // Textures stream in behind placeholders, so the Model only waits for its mesh
+    std::vector<Texture> textures = materialTextures(sources);
     
-    // Bind the normal buffer
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    std::string file = path;
+    return AssetLoader::instance().upload([file, mesh, textures]() {
+        auto model = std::make_shared<Model>(mesh.get());
+        if (isGlbPath(file.c_str()))
+        {
+            model->loadGlbTextures(file.c_str());
+        }
+        model->textures.insert(model->textures.end(), textures.begin(), textures.end());
+        return model;
+    }, { mesh.dependency() });
+}
+
+void Model::draw(const ShaderProgram &program, DrawBlock &block, size_t lod)
+{
+    bindMaterial(program, block);
+    mesh->draw(block, lod);
+}
+
+void Model::draw(const ShaderProgram &program, DrawBlock &block, size_t lod, const glm::mat4 &modelView,
+                 const glm::mat4 &projection)
+{
+    bindMaterial(program, block);
+    mesh->draw(block, lod, modelView, projection);
+}
+
+void Model::swapInReplacements()
+{
+    for (Texture &texture : textures)
+    {
+        // A replacement counts as drawn while it waits, so it is not evicted before it is
+        // swapped in, and streams in again if it was
+        if (texture.pending)
+        {
+            texture.pending->lastDrawn = ResidencyManager::instance().now();
+            if (texture.pending->evicted)
+            {
+                TextureStreamer::instance().reload(texture.pending);
+            }
+        }
+        if (texture.pending && texture.pending->resident)
+        {
+            texture.shared = std::move(texture.pending);
+            texture.layer.reset();
+        }
+        if (texture.pendingLayer && texture.pendingLayer->resident)
+        {
+            texture.layer = std::move(texture.pendingLayer);
+            texture.shared.reset();
+        }
+    }
+}
 
-    glEnableVertexAttribArray(3);
-    glBindBuffer(GL_ARRAY_BUFFER, tangentBuffer);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+MaterialFeatures Model::materialFeatures()
+{
+    swapInReplacements();
+    MaterialFeatures features;
+    features.normalMap = features.specularMap = false;
+    for (const Texture &texture : textures)
+    {
+        bool sampled = texture.packed || !(texture.layer && texture.layer->constant);
+        if (texture.type == "normal")
+            features.normalMap = sampled;
+        else if (texture.type == "specular")
+            features.specularMap = sampled;
+    }
+    return features;
+}
 
-    glEnableVertexAttribArray(4);
-    glBindBuffer(GL_ARRAY_BUFFER, bitangentBuffer);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+void Model::bindMaterial(const ShaderProgram &program, DrawBlock &block)
+{
+    // Material properties go out with the draw's block
+    block.ka = ka;
+    block.kd = kd;
+    block.ks = ks;
+    block.Ns = Ns;
     
-     // Unbind the VAO
-    glBindVertexArray(0);
+    // Maps in a texture array are picked by layer, -1 while streaming, -2 for maps bound on their own,
+    // -3 for maps of one colour and -4 for specular packed into the diffuse layer. Missing maps
+    // read as a flat normal and the placeholder grey
+    swapInReplacements();
+    glm::ivec3 layers(-2);
+    glm::vec4 constants[TEXTURE_USAGE_COUNT] = { glm::vec4(0.5f), glm::vec4(0.5f, 0.5f, 1.0f, 1.0f), glm::vec4(0.5f) };
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        Texture &texture = textures[i];
+        if (texture.packed)
+        {
+            layers[TEXTURE_SPECULAR] = -4;
+            continue;
+        }
+        if (texture.layer && texture.layer->constant)
+        {
+            layers[texture.layer->usage] = -3;
+            for (int c = 0; c < 4; c++)
+            {
+                constants[texture.layer->usage][c] = texture.layer->colour[c] / 255.0f;
+            }
+            continue;
+        }
+        if (texture.layer)
+        {
+            layers[texture.layer->usage] = texture.layer->resident ? texture.layer->index : -1;
+            continue;
+        }
+        
+        // Stream an evicted texture in again, drawing its placeholder meanwhile
+        texture.shared->lastDrawn = ResidencyManager::instance().now();
+        if (texture.shared->evicted)
+        {
+            TextureStreamer::instance().reload(texture.shared);
+        }
+        
+        // Bind texture
+        static const ShaderUniform<int> maps[TEXTURE_USAGE_COUNT] = { Uniforms::diffuseMap, Uniforms::normalMap,
+                                                                      Uniforms::specularMap };
+        glActiveTexture(GL_TEXTURE0 + i);
+        program.set(maps[texture.usage], static_cast<int>(i));
+        glBindTexture(GL_TEXTURE_2D, texture.shared->id);
+    }
+    block.materialLayers = layers;
+    std::copy(constants, constants + TEXTURE_USAGE_COUNT, block.materialConstants);
+}
+
+void Model::requestTextureDetail(float pixelsPerRepeat)
+{
+    TextureArrays &arrays = TextureArrays::instance();
+    for (const Texture &texture : textures)
+    {
+        if (texture.layer)
+        {
+            arrays.request(*texture.layer, pixelsPerRepeat);
+        }
+        if (texture.pendingLayer)
+        {
+            arrays.request(*texture.pendingLayer, pixelsPerRepeat);
+        }
+    }
 }
 
 void Model::deleteBuffers()
 {
-    glDeleteBuffers(1, &vertexBuffer);
-    glDeleteBuffers(1, &uvBuffer);
-    glDeleteBuffers(1, &normalBuffer);
-    glDeleteBuffers(1, &bitangentBuffer);
-    glDeleteBuffers(1, &tangentBuffer);
-    glDeleteVertexArrays(1, &VAO);
+    mesh.reset();
+    textures.clear();
 }
 
-bool Model::loadObj(const char *path,
-                    std::vector<glm::vec3> &outVertices,
-                    std::vector<glm::vec2> &outUVs,
-                    std::vector<glm::vec3> &outNormals)
+void Model::loadGlbTextures(const char *path)
 {
+    GlbFile glb(path);
     
-    printf("Loading file %s\n", path);
-    
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
-    std::vector<glm::vec3> tempVertices;
-    std::vector<glm::vec2> tempUVs;
-    std::vector<glm::vec3> tempNormals;
-    
-    FILE *file = fopen(path, "r");
-    if (file==NULL)
+    // Use the first material with textures, the Model has a single material
+    const GlbMaterial* material = nullptr;
+    for (const GlbMaterial &candidate : glb.materials())
+    {
+        if (candidate.baseColour >= 0 || candidate.normal >= 0)
+        {
+            material = &candidate;
+            break;
+        }
+    }
+    if (!material)
     {
-        printf("Impossible to open the file. Check paths and directories.");
-        getchar();
-        return false;
+        return;
     }
     
-    while (true)
+    // Embedded images are keyed by file and image index. Ones not already on the GPU
+    // come from the texture cache, and only decoded when their image is not cooked yet
+    AssetRegistry &registry = AssetRegistry::instance();
+    std::string prefix = AssetRegistry::canonicalPath(path) + "#image";
+    bool allowS3tc = TextureStreamer::instance().supportsS3tc();
+    // glTF has no specular map, and roughness or metalness is not a specular intensity,
+    // so the material keeps its constant specular
+    struct Slot { int image; const char* type; std::shared_ptr<SharedTexture> texture; SourceStamp content; std::string cachedPath; };
+    Slot slots[] = {
+        { material->baseColour, "diffuse", nullptr, {}, {} },
+        { material->normal,     "normal",  nullptr, {}, {} },
+    };
+    bool missing = false;
+    for (Slot &slot : slots)
     {
-        // Read the first word of the line
-        char lineHeader[128];
-        int res = fscanf(file, "%s", lineHeader);
-        if (res == EOF)
+        if (slot.image < 0 || static_cast<size_t>(slot.image) >= glb.images().size())
         {
-            // If end of file reached exit the loop
-            break;
+            continue;
         }
-        
-        if (strcmp(lineHeader, "v") == 0)
+        std::string key = prefix + std::to_string(slot.image);
+        slot.texture = registry.findTexture(key);
+        if (slot.texture)
         {
-            // Read vertices
-            glm::vec3 vertex;
-            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-            tempVertices.push_back(vertex);
+            continue;
         }
-        else if (strcmp(lineHeader, "vt") == 0)
+        auto start = std::chrono::steady_clock::now();
+        const GlbImage &image = glb.images()[slot.image];
+        slot.content = stampBytes(image.data, image.size);
+        slot.cachedPath = cachedTexturePath(path, slot.content, usageFor(slot.type));
+        KtxInfo info;
+        if (readCachedTexture(slot.cachedPath.c_str(), slot.content, usageFor(slot.type), allowS3tc, info))
         {
-            // Read texture co-ordinates
-            glm::vec2 uv;
-            fscanf(file, "%f %f\n", &uv.x, &uv.y);
-            tempUVs.push_back(uv);
+            slot.texture = uploadCookedTexture(slot.cachedPath.c_str(), info);
         }
-        else if (strcmp(lineHeader, "vn") == 0)
+        if (slot.texture)
         {
-            // Read vertex normals
-            glm::vec3 normal;
-            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-            tempNormals.push_back(normal);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            slot.texture->loadMilliseconds = elapsed.count();
+            printf("Loaded embedded image %d from %s in %.2f ms\n", slot.image, slot.cachedPath.c_str(), elapsed.count());
+            registry.addTexture(key, slot.texture);
         }
-        else if (strcmp(lineHeader, "f") == 0)
+        missing = missing || !slot.texture;
+    }
+    
+    if (missing)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<DecodedImage> images = glb.decodeImages();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        printf("Decoded %zu embedded images in %.2f ms\n", images.size(), elapsed.count());
+        for (Slot &slot : slots)
         {
-            // Read vertex indices
-            std::string vertex1, vertex2, vertex3;
-            unsigned int vertexIndex[3], uvIndex[3], normalIndex[3];
-            int matches = fscanf(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n",
-                                 &vertexIndex[0], &uvIndex[0], &normalIndex[0],
-                                 &vertexIndex[1], &uvIndex[1], &normalIndex[1],
-                                 &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-            
-            // Check for error
-            if (matches != 9)
+            if (slot.texture || slot.image < 0 || static_cast<size_t>(slot.image) >= images.size() || !images[slot.image].pixels)
+            {
+                continue;
+            }
+            // Cook into the cache so the next run skips the decode, uploading as before when it cannot be written
+            const DecodedImage &image = images[slot.image];
+            TextureUsage usage = usageFor(slot.type);
+            KtxInfo info;
+            if (cookPixels(slot.cachedPath.c_str(), image.pixels, image.width, image.height, image.components,
+                           slot.content, slot.cachedPath.c_str(), usage, allowS3tc) &&
+                readCachedTexture(slot.cachedPath.c_str(), slot.content, usage, allowS3tc, info))
+            {
+                slot.texture = uploadCookedTexture(slot.cachedPath.c_str(), info);
+            }
+            if (!slot.texture)
             {
-                printf("File can't be read by loadObj().\n");
-                fclose(file);
-                return false;
+                slot.texture = uploadTexture(image.pixels, image.width, image.height, image.components, usage);
             }
-            vertexIndices.push_back(vertexIndex[0]);
-            vertexIndices.push_back(vertexIndex[1]);
-            vertexIndices.push_back(vertexIndex[2]);
-            uvIndices    .push_back(uvIndex[0]);
-            uvIndices    .push_back(uvIndex[1]);
-            uvIndices    .push_back(uvIndex[2]);
-            normalIndices.push_back(normalIndex[0]);
-            normalIndices.push_back(normalIndex[1]);
-            normalIndices.push_back(normalIndex[2]);
+            slot.texture->loadMilliseconds = elapsed.count() / images.size();
+            registry.addTexture(prefix + std::to_string(slot.image), slot.texture);
         }
-        else
+        for (DecodedImage &image : images)
         {
-            // Remove comment line
-            char commentBuffer[1000];
-            fgets(commentBuffer, 1000, file);
+            stbi_image_free(image.pixels);
         }
     }
     
-    // For each vertex of the triangle
-    for (unsigned int i = 0; i < vertexIndices.size(); i++)
+    for (const Slot &slot : slots)
     {
-        // Get the indices of its attributes
-        unsigned int vertexIndex = vertexIndices[i];
-        unsigned int uvIndex = uvIndices[i];
-        unsigned int normalIndex = normalIndices[i];
-        
-        // Get the attributes
-        glm::vec3 vertex = tempVertices[vertexIndex - 1];
-        glm::vec2 uv = tempUVs[uvIndex - 1];
-        glm::vec3 normal = tempNormals[normalIndex - 1];
-        
-        // Copy the attributes to the buffers
-        outVertices.push_back(vertex);
-        outUVs.push_back(uv);
-        outNormals.push_back(normal);
+        if (slot.texture)
+        {
+            Texture texture;
+            texture.type = slot.type;
+            texture.usage = usageFor(slot.type);
+            texture.shared = slot.texture;
+            textures.push_back(texture);
+        }
     }
-    
-    // Close .obj file
-    fclose(file);
-    
-    return true;
 }
 
 void Model::addTexture(const char *path, const char* type)
 {
-    if (!textures.data()) {
-        textures = std::vector<Texture>();
-    }
-    Texture texture;
-    texture.id = loadTexture(path);
-    texture.type = std::string(type);
-    textures.push_back(texture);
+    textures.push_back(materialTexture(path, type));
     std::cout << "Added texture: " << path << "\n";
 }
 
 void Model::setTexture(const char* path, const char* type) {
+    Texture* diffuse = nullptr;
+    Texture* specular = nullptr;
+    for (Texture& texture : textures) {
+        if (texture.type == "diffuse") diffuse = &texture;
+        if (texture.packed) specular = &texture;
+    }
     for (Texture& texture : textures) {
         if (strcmp(texture.type.c_str(), type) == 0) {
-            glDeleteTextures(1, &texture.id);
-            texture.id = loadTexture(path);
+            texture.path = path;
+            if (texture.packed) {
+                continue;
+            }
+            // The replacement waits as pending and the old texture keeps drawing until it is
+            // resident, when the swap drops the old texture's reference
+            const char* packedPath = specular && &texture == diffuse ? specular->path.c_str() : nullptr;
+            texture.pendingLayer = arrayLayer(path, texture.type, packedPath);
+            texture.pending = texture.pendingLayer ? nullptr : AssetRegistry::instance().texture(path, usageFor(type));
         }
     }
-}
-
-unsigned int Model::loadTexture(const char *path)
-{
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, numComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &numComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (numComponents == 1)
-            format = GL_RED;
-        else if (numComponents == 3)
-            format = GL_RGB;
-        else if (numComponents == 4)
-            format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+    // A packed specular map changes with the diffuse layer holding it
+    if (specular && diffuse && strcmp(type, "specular") == 0) {
+        diffuse->pendingLayer = arrayLayer(diffuse->path.c_str(), diffuse->type, path);
+        diffuse->pending = diffuse->pendingLayer ? nullptr : AssetRegistry::instance().texture(diffuse->path.c_str(), TEXTURE_COLOUR);
     }
-    else
-    {
-        std::cout << "Texture " << path << " failed to load." << std::endl;
-        stbi_image_free(data);
+    // Without a diffuse layer to live in, the specular map gets a texture of its own
+    if (specular && diffuse && !diffuse->pendingLayer && diffuse->pending) {
+        specular->packed = false;
+        specular->shared = AssetRegistry::instance().texture(specular->path.c_str(), TEXTURE_SPECULAR);
     }
-
-    return textureID;
 }
 
-void Model::calculateNormals() {
-    for (size_t i = 0; i < vertices.size(); i += 3) {
-        glm::vec3 e1 = vertices[i + 1] - vertices[i + 0];
-        glm::vec3 e2 = vertices[i + 2] - vertices[i + 1];
-        glm::vec2 dU = { uvs[i + 1].x - uvs[i + 0].x , uvs[i + 2].x - uvs[i + 1].x };
-        glm::vec2 dV = { uvs[i + 1].y - uvs[i + 0].y , uvs[i + 2].y - uvs[i + 1].y };
-
-        glm::vec2 currDelta = { uvs[i + 1].x - uvs[i + 0].x, uvs[i + 1].y - uvs[i + 0].y };
-        glm::vec2 nextDelta = { uvs[i + 2].x - uvs[i + 1].x, uvs[i + 2].y - uvs[i + 1].y };
-
-        float denom = 1.0f / (currDelta.x * nextDelta.y - nextDelta.x * currDelta.y);
-        glm::vec3 tangent = (nextDelta.y * e1 - currDelta.y * e2) * denom;
-        glm::vec3 bitangent = (currDelta.x * e2 - nextDelta.x * e1) * denom;
-
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-    }
-}
 
 void Model::setDiffusionParameters(glm::vec4 params) {
     ka = params.x;
@@ -1,68 +1,90 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include <stdio.h>
 #include <string>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
-// Texture struct
+#include "mesh.hpp"
+#include "asset_registry.hpp"
+#include "shader_variants.hpp"
+#include "texture_arrays.hpp"
+
+// Texture struct, either a texture of its own or a layer of a texture array. A
+// specular map can instead be packed into the alpha of the diffuse layer
 struct Texture
 {
-    unsigned int id;
     std::string type = "";
+    TextureUsage usage = TEXTURE_COLOUR;
+    std::string path;
+    bool packed = false;
+    std::shared_ptr<SharedTexture> shared;
+    std::shared_ptr<SharedTexture> pending; // replacement still streaming in
+    std::shared_ptr<TextureLayer> layer;
+    std::shared_ptr<TextureLayer> pendingLayer;
 };
 
+// Texture file and the material slot it fills
+struct TextureSource
+{
+    std::string path;
+    std::string type;
+};
+
+// Material of one instance drawn with geometry shared through the AssetRegistry
 class Model
 {
 public:
     // Model attributes
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec2> uvs;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec3> bitangents;
-    std::vector<glm::vec3> tangents;
+    std::shared_ptr<Mesh>  mesh;
     std::vector<Texture>   textures;
     float ka = 0.8f, kd, ks, Ns = 20.0f;
     
-    // Constructor
-    Model(const char *path);
+    // Constructor for .obj and .glb files, optionally storing vertices in a compressed format
+    Model(const char *path, VertexCompression compression = VERTEX_FLOAT);
+    explicit Model(std::shared_ptr<Mesh> mesh);
+    
+    // Loads the mesh and textures through the AssetLoader, the Model is assembled
+    // on the context thread once all of them are uploaded
+    static AssetHandle<std::shared_ptr<Model>> loadAsync(const char *path, VertexCompression compression,
+                                                        const std::vector<TextureSource> &sources);
     
-    // Draw model
-    void draw(unsigned int &shaderID);
+    // Draw model at a level of detail, with the matrices and tint the block already holds
+    void draw(const ShaderProgram &program, DrawBlock &block, size_t lod = 0);
+    
+    // Draw only the meshlets inside the frustum that face the camera
+    void draw(const ShaderProgram &program, DrawBlock &block, size_t lod, const glm::mat4 &modelView,
+              const glm::mat4 &projection);
+    
+    // Maps the material samples, which picks its shader variant. Replacement textures
+    // that have streamed in are swapped in first, so the variant matches what is bound
+    MaterialFeatures materialFeatures();
+    
+    // Asks the texture arrays for the mip level the textures need when one texture
+    // repeat covers the given pixels on screen
+    void requestTextureDetail(float pixelsPerRepeat);
     
     // Add textures
     void addTexture(const char *path, const char* type);
     void setTexture(const char* path, const char* type);
     
-    // Cleanup
+    // Cleanup, GPU resources go once no other Model shares them
     void deleteBuffers();
     void setDiffusionParameters(glm::vec4 params);
     void setDiffusionParameters(float ka, float kd, float ks, float ns);
     
 private:
     
-    // Array buffers
-    unsigned int VAO;
-    unsigned int vertexBuffer;
-    unsigned int uvBuffer;
-    unsigned int normalBuffer;
-    unsigned int tangentBuffer;
-    unsigned int bitangentBuffer;
+    // Load the textures embedded in a .glb file
+    void loadGlbTextures(const char *path);
     
-    // Load .obj file method
-    bool loadObj(const char *path,
-                 std::vector<glm::vec3> &inVertices,
-                 std::vector<glm::vec2> &inUVs,
-                 std::vector<glm::vec3> &inNormals);
-    
-    // Setup buffers
-    void setupBuffers();
-
-    void calculateNormals();
+    // Swap in replacement textures once they have streamed in
+    void swapInReplacements();
     
-    // Load texture
-    unsigned int loadTexture(const char *path);
+    // Bind material state shared by both draws
+    void bindMaterial(const ShaderProgram &program, DrawBlock &block);
 
     //! Sets KA, KD, KS and NS
     ///
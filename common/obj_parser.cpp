@@ -0,0 +1,370 @@
+#include "obj_parser.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OBJ_PARSER_SSE2
+#endif
+
+#include "mapped_file.hpp"
+
+namespace {
+
+// Chunks smaller than this are not worth a thread
+const size_t minChunkBytes = 256 * 1024;
+
+enum LineType { LINE_OTHER, LINE_POSITION, LINE_UV, LINE_NORMAL, LINE_FACE };
+
+struct Counts
+{
+    size_t positions = 0;
+    size_t uvs = 0;
+    size_t normals = 0;
+    size_t corners = 0;
+};
+
+struct Chunk
+{
+    const char* begin;
+    const char* end;
+    Counts counts;
+    Counts base;
+    bool valid = true;
+};
+
+const double powersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool isDigit(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isSpace(*p) && *p != '\n') {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* nextLine(const char* p, const char* end) {
+    const void* newline = memchr(p, '\n', static_cast<size_t>(end - p));
+    return newline ? static_cast<const char*>(newline) + 1 : end;
+}
+
+inline unsigned popCount(unsigned bits) {
+    bits = bits - ((bits >> 1) & 0x55555555u);
+    bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+    return (((bits + (bits >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+}
+
+// Counts whitespace separated tokens in [p, end), 16 bytes at a time where possible
+size_t countTokens(const char* p, const char* end) {
+    size_t tokens = 0;
+    bool space = true;
+#ifdef OBJ_PARSER_SSE2
+    const __m128i spaces   = _mm_set1_epi8(' ');
+    const __m128i tabs     = _mm_set1_epi8('\t');
+    const __m128i returns  = _mm_set1_epi8('\r');
+    const __m128i newlines = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i isBlank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, spaces), _mm_cmpeq_epi8(bytes, tabs)),
+                                       _mm_or_si128(_mm_cmpeq_epi8(bytes, returns), _mm_cmpeq_epi8(bytes, newlines)));
+        unsigned blank = static_cast<unsigned>(_mm_movemask_epi8(isBlank));
+        // A token starts on a non-blank byte whose predecessor is blank
+        unsigned previousBlank = ((blank << 1) | (space ? 1u : 0u)) & 0xFFFFu;
+        tokens += popCount(~blank & previousBlank & 0xFFFFu);
+        space = (blank & 0x8000u) != 0;
+    }
+#endif
+    for (; p < end; ++p) {
+        bool blank = isSpace(*p) || *p == '\n';
+        tokens += space && !blank;
+        space = blank;
+    }
+    return tokens;
+}
+
+// Reads the keyword at the start of a line and moves p past it
+LineType classify(const char*& p, const char* end) {
+    p = skipSpaces(p, end);
+    if (end - p < 2) {
+        return LINE_OTHER;
+    }
+    if (p[0] == 'v') {
+        if (isSpace(p[1])) {
+            p += 1;
+            return LINE_POSITION;
+        }
+        if (end - p > 2 && isSpace(p[2])) {
+            if (p[1] == 't') {
+                p += 2;
+                return LINE_UV;
+            }
+            if (p[1] == 'n') {
+                p += 2;
+                return LINE_NORMAL;
+            }
+        }
+    } else if (p[0] == 'f' && isSpace(p[1])) {
+        p += 1;
+        return LINE_FACE;
+    }
+    return LINE_OTHER;
+}
+
+// Decimal float scanner, accurate to within an ulp for the values OBJ exporters write
+inline const char* parseFloat(const char* p, const char* end, float &out) {
+    p = skipSpaces(p, end);
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    const char* digitsBegin = p;
+    uint64_t mantissa = 0;
+    while (p < end && isDigit(*p)) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    ptrdiff_t digits = p - digitsBegin;
+    int exponent = 0;
+    if (p < end && *p == '.') {
+        const char* fraction = ++p;
+        while (p < end && isDigit(*p)) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            ++p;
+        }
+        digits += p - fraction;
+        exponent = -static_cast<int>(p - fraction);
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        int value = 0;
+        while (p < end && isDigit(*p)) {
+            value = std::min(value * 10 + (*p - '0'), 10000);
+            ++p;
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    if (digits > 19 || exponent < -22 || exponent > 22) {
+        // Mantissa overflowed or the power of ten is inexact, let the C library handle it
+        char buffer[64];
+        size_t length = std::min<size_t>(static_cast<size_t>(p - start), sizeof(buffer) - 1);
+        memcpy(buffer, start, length);
+        buffer[length] = '\0';
+        out = strtof(buffer, nullptr);
+        return p;
+    }
+
+    double value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+// Reads a 1-based (or negative, relative) index and converts it to 0-based
+inline const char* parseIndex(const char* p, const char* end, size_t count, uint32_t &out) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    uint64_t value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    if (value == 0 || value > count) {
+        // Forward references are invalid in .obj, so anything past the count seen so
+        // far is out of range
+        out = ObjData::missing;
+    } else {
+        out = static_cast<uint32_t>(negative ? count - value : value - 1);
+    }
+    return p;
+}
+
+// First pass: count every element so the output can be sized once
+void countChunk(Chunk &chunk) {
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    while (p < end) {
+        switch (classify(p, end)) {
+            case LINE_POSITION: chunk.counts.positions++; break;
+            case LINE_UV:       chunk.counts.uvs++;       break;
+            case LINE_NORMAL:   chunk.counts.normals++;   break;
+            case LINE_FACE: {
+                const char* lineEnd = nextLine(p, end);
+                size_t tokens = countTokens(p, lineEnd);
+                p = lineEnd;
+                if (tokens > 2) {
+                    chunk.counts.corners += 3 * (tokens - 2);
+                }
+                continue;
+            }
+            case LINE_OTHER: break;
+        }
+        p = nextLine(p, end);
+    }
+}
+
+// Second pass: parse straight into the slots reserved by the counting pass
+void parseChunk(Chunk &chunk, ObjData &out) {
+    glm::vec3* positions = out.positions.data() + chunk.base.positions;
+    glm::vec2* uvs       = out.uvs.data()       + chunk.base.uvs;
+    glm::vec3* normals   = out.normals.data()   + chunk.base.normals;
+    ObjCorner* corners   = out.corners.data()   + chunk.base.corners;
+    size_t positionCount = chunk.base.positions;
+    size_t uvCount       = chunk.base.uvs;
+    size_t normalCount   = chunk.base.normals;
+
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    while (p < end) {
+        switch (classify(p, end)) {
+            case LINE_POSITION: {
+                glm::vec3 &position = *positions++;
+                p = parseFloat(p, end, position.x);
+                p = parseFloat(p, end, position.y);
+                p = parseFloat(p, end, position.z);
+                positionCount++;
+                break;
+            }
+            case LINE_UV: {
+                glm::vec2 &uv = *uvs++;
+                p = parseFloat(p, end, uv.x);
+                p = parseFloat(p, end, uv.y);
+                uvCount++;
+                break;
+            }
+            case LINE_NORMAL: {
+                glm::vec3 &normal = *normals++;
+                p = parseFloat(p, end, normal.x);
+                p = parseFloat(p, end, normal.y);
+                p = parseFloat(p, end, normal.z);
+                normalCount++;
+                break;
+            }
+            case LINE_FACE: {
+                ObjCorner first, previous;
+                size_t tokens = 0;
+                p = skipSpaces(p, end);
+                while (p < end && *p != '\n') {
+                    ObjCorner corner = { ObjData::missing, ObjData::missing, ObjData::missing };
+                    p = parseIndex(p, end, positionCount, corner.position);
+                    if (p < end && *p == '/') {
+                        ++p;
+                        if (p < end && *p != '/') {
+                            p = parseIndex(p, end, uvCount, corner.uv);
+                        }
+                        if (p < end && *p == '/') {
+                            p = parseIndex(p + 1, end, normalCount, corner.normal);
+                        }
+                    }
+                    p = skipSpaces(skipToken(p, end), end);
+
+                    if (corner.position == ObjData::missing) {
+                        chunk.valid = false;
+                    }
+
+                    if (tokens == 0) {
+                        first = corner;
+                    } else if (tokens >= 2) {
+                        *corners++ = first;
+                        *corners++ = previous;
+                        *corners++ = corner;
+                    }
+                    previous = corner;
+                    tokens++;
+                }
+                break;
+            }
+            case LINE_OTHER: break;
+        }
+        p = nextLine(p, end);
+    }
+}
+
+template <typename Function>
+void forEachChunk(std::vector<Chunk> &chunks, Function function) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++) {
+        workers.emplace_back(function, std::ref(chunks[i]));
+    }
+    function(chunks[0]);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+}
+
+bool parseObj(const char *path, ObjData &out) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        printf("Impossible to open the file. Check paths and directories.\n");
+        return false;
+    }
+
+    // Split the file on line boundaries, one chunk per hardware thread
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunkCount = std::max<size_t>(1, std::min(threads, file.size() / minChunkBytes));
+    std::vector<Chunk> chunks(chunkCount);
+    const char* chunkBegin = begin;
+    for (size_t i = 0; i < chunkCount; i++) {
+        const char* chunkEnd = i + 1 == chunkCount ? end : nextLine(begin + file.size() * (i + 1) / chunkCount, end);
+        chunks[i].begin = chunkBegin;
+        chunks[i].end = std::max(chunkBegin, chunkEnd);
+        chunkBegin = chunks[i].end;
+    }
+
+    forEachChunk(chunks, countChunk);
+
+    // Prefix sum the counts to get each chunk's write offsets
+    Counts total;
+    for (Chunk &chunk : chunks) {
+        chunk.base = total;
+        total.positions += chunk.counts.positions;
+        total.uvs       += chunk.counts.uvs;
+        total.normals   += chunk.counts.normals;
+        total.corners   += chunk.counts.corners;
+    }
+    out.positions.resize(total.positions);
+    out.uvs.resize(total.uvs);
+    out.normals.resize(total.normals);
+    out.corners.resize(total.corners);
+
+    forEachChunk(chunks, [&out](Chunk &chunk) { parseChunk(chunk, out); });
+
+    for (const Chunk &chunk : chunks) {
+        if (!chunk.valid) {
+            printf("File can't be read by loadObj().\n");
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Attribute indices of one triangle corner, 0-based
+struct ObjCorner
+{
+    uint32_t position;
+    uint32_t uv;
+    uint32_t normal;
+};
+
+// Raw contents of an .obj file
+struct ObjData
+{
+    // Index used when a face corner has no uv or normal
+    static const uint32_t missing = 0xFFFFFFFFu;
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    // Three corners per triangle, polygons are fan triangulated
+    std::vector<ObjCorner> corners;
+};
+
+// Memory maps the file and parses it in chunks across worker threads
+bool parseObj(const char *path, ObjData &out);
@@ -1,13 +1,66 @@
 #include "object.hpp"
 #include "glm/gtc/type_ptr.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Largest screen space error a LOD may show, in pixels
+const float lodPixelError = 1.0f;
+// Margin a coarser LOD must clear before it is picked, so objects don't flicker at the boundary
+const float lodHysteresis = 0.25f;
+}
 
 glm::mat4 Object::modelMat() {
   return Maths::translate(position) * rotation.matrix() * Maths::scale(scale);
 }
-void Object::draw(uint32_t shaderID) {
+float Object::pixelsPerUnit(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight) {
+  // Distance to the nearest point of the world space bounding sphere
+  float objectScale = std::max(std::fabs(scale.x), std::max(std::fabs(scale.y), std::fabs(scale.z)));
+  glm::vec3 centre = glm::vec3(modelMat() * glm::vec4(0.5f * (model->mesh->boundsMin + model->mesh->boundsMax), 1.0f));
+  float radius = 0.5f * glm::length(model->mesh->boundsMax - model->mesh->boundsMin) * objectScale;
+  float distance = std::max(glm::length(centre - cameraPosition) - radius, 1e-3f);
+  return objectScale * projection[1][1] * 0.5f * viewportHeight / distance;
+}
+
+void Object::selectLod(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight) {
+  if (!model || model->mesh->lods.size() < 2) {
+    lod = 0;
+    return;
+  }
+
+  float pixelsPerUnit = this->pixelsPerUnit(cameraPosition, projection, viewportHeight);
+  size_t selected = 0;
+  for (size_t i = 1; i < model->mesh->lods.size(); i++) {
+    float threshold = i > lod ? lodPixelError * (1.0f - lodHysteresis) : lodPixelError;
+    if (model->mesh->lods[i].error * pixelsPerUnit > threshold) {
+      break;
+    }
+    selected = i;
+  }
+  lod = selected;
+}
+
+void Object::requestTextures(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight) {
+  // A mesh without uvs samples a single texel, which the coarse levels cover
+  if (!model || model->mesh->uvDensity <= 0.0f) {
+    return;
+  }
+  model->requestTextureDetail(pixelsPerUnit(cameraPosition, projection, viewportHeight) / model->mesh->uvDensity);
+}
+
+void Object::draw(const ShaderProgram& program, const glm::mat4& view, const glm::mat4& projection) {
+  if (model) {
+    DrawBlock block;
+    block.MV = view * modelMat();
+    block.MVP = projection * block.MV;
+    block.modelTint = tint;
+    model->draw(program, block, lod, block.MV, projection);
+  }
+}
+
+void Object::draw(ShaderVariants& variants, const glm::mat4& view, const glm::mat4& projection) {
   if (model) {
-    glUniform3fv(glGetUniformLocation(shaderID, "modelTint"), 1, glm::value_ptr(tint));
-    model->draw(shaderID);
+    draw(variants.use(model->materialFeatures()), view, projection);
   }
 }
 
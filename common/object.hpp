@@ -13,9 +13,21 @@ public:
   std::string name = "Object";
   Model* model = nullptr;
   glm::vec3 tint = glm::vec3(1.0f);
+  size_t lod = 0;
 
   Object(const glm::vec3& position, const glm::vec3& scale, const Quaternion& rotation, const char* name, Model* model);
 
   glm::mat4 modelMat();
-  void draw(uint32_t shaderID);
+  // Picks the coarsest LOD whose error stays under a pixel at the object's projected size
+  void selectLod(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
+  // Requests the texture mip level the object's texel density on screen calls for
+  void requestTextures(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
+  // Draws only the meshlets of the current LOD that are visible from the camera
+  void draw(const ShaderProgram& program, const glm::mat4& view, const glm::mat4& projection);
+  // Draws with the lit variant matching the model's material, setting its matrices
+  void draw(ShaderVariants& variants, const glm::mat4& view, const glm::mat4& projection);
+
+private:
+  // Pixels one object space unit covers at the nearest point of the bounding sphere
+  float pixelsPerUnit(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
 };
@@ -0,0 +1,103 @@
+#include "program_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "cooked_mesh.hpp"
+#include "gl_extensions.hpp"
+
+namespace {
+
+const char programMagic[8] = { 'C', 'W', 'P', 'R', 'O', 'G', '1', '\0' };
+
+struct ProgramHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
+
+}
+
+std::string programDriverKey() {
+    if (!hasExtension("GL_ARB_get_program_binary")) {
+        return std::string();
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        return std::string();
+    }
+    std::string key;
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const GLubyte *value = glGetString(name);
+        key += value ? reinterpret_cast<const char*>(value) : "";
+        key += '\n';
+    }
+    return key;
+}
+
+uint64_t programCacheKey(const std::string &driverKey, const std::vector<const std::string*> &sources) {
+    // Stages are separated by a NUL, which no GLSL source contains
+    std::string keyed = driverKey;
+    for (const std::string *source : sources) {
+        keyed += '\0';
+        keyed += *source;
+    }
+    return stampBytes(keyed.data(), keyed.size()).hash;
+}
+
+std::string programCachePath(const char *shaderPath, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.glbin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(shaderPath).parent_path() / "shader_cache" / name).string();
+}
+
+bool readProgramBinary(const char *path, uint64_t key, ProgramBinary &binary) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    ProgramHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, programMagic, sizeof(programMagic)) == 0 && header.key == key && header.size > 0;
+    if (ok) {
+        binary.format = header.format;
+        binary.data.resize(header.size);
+        ok = fread(binary.data.data(), 1, header.size, file) == header.size;
+    }
+    fclose(file);
+    if (!ok) {
+        binary = ProgramBinary();
+    }
+    return ok;
+}
+
+bool writeProgramBinary(const char *path, uint64_t key, const ProgramBinary &binary) {
+    ProgramHeader header;
+    memcpy(header.magic, programMagic, sizeof(programMagic));
+    header.key = key;
+    header.format = binary.format;
+    header.size = static_cast<uint32_t>(binary.data.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    return writeFileReplacing(path, [&](FILE *file) {
+        return fwrite(&header, sizeof(header), 1, file) == 1 &&
+               fwrite(binary.data.data(), 1, binary.data.size(), file) == binary.data.size();
+    });
+}
+
+bool retrieveProgramBinary(GLuint program, ProgramBinary &binary) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    binary.data.resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+    binary.data.resize(written);
+    return written > 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Linked program as the driver returns it, only loadable by the same driver
+struct ProgramBinary {
+    GLenum format = 0;
+    std::vector<char> data;
+};
+
+// Vendor, renderer and version of the driver, empty when it cannot return program
+// binaries. Context thread only
+std::string programDriverKey();
+
+// Hash of the driver key and every stage's source, which a cached binary must match
+uint64_t programCacheKey(const std::string &driverKey, const std::vector<const std::string*> &sources);
+
+// Binaries are cached in a shader_cache directory next to the first stage, named after their key
+std::string programCachePath(const char *shaderPath, uint64_t key);
+
+// Binary cached under the key, false when there is none
+bool readProgramBinary(const char *path, uint64_t key, ProgramBinary &binary);
+bool writeProgramBinary(const char *path, uint64_t key, const ProgramBinary &binary);
+
+// Binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT. Context thread only
+bool retrieveProgramBinary(GLuint program, ProgramBinary &binary);
@@ -0,0 +1,100 @@
+#include "residency_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "asset_registry.hpp"
+#include "mesh.hpp"
+#include "texture_arrays.hpp"
+#include "texture_streamer.hpp"
+
+ResidencyManager& ResidencyManager::instance() {
+    static ResidencyManager residencyManager;
+    return residencyManager;
+}
+
+void ResidencyManager::update() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    clock = elapsed.count();
+
+    AssetRegistry &registry = AssetRegistry::instance();
+    TextureArrays &arrays = TextureArrays::instance();
+    std::vector<std::shared_ptr<Mesh>> meshes = registry.liveMeshes();
+    std::vector<std::shared_ptr<SharedTexture>> textures = registry.liveTextures();
+
+    size_t arrayBytes = arrays.residentBytes();
+    resident = arrayBytes;
+    for (const std::shared_ptr<Mesh> &mesh : meshes) {
+        resident += mesh->isResident() ? mesh->gpuBytes : 0;
+    }
+    for (const std::shared_ptr<SharedTexture> &texture : textures) {
+        resident += texture->resident ? texture->bytes : 0;
+    }
+
+    // Evict what no frame has drawn for a while, least recently drawn first
+    if (resident > budgetBytes) {
+        struct Candidate {
+            double lastDrawn;
+            Mesh *mesh;
+            SharedTexture *texture;
+        };
+        std::vector<Candidate> candidates;
+        for (const std::shared_ptr<Mesh> &mesh : meshes) {
+            if (mesh->isResident() && clock - mesh->lastDrawn > idleSeconds) {
+                candidates.push_back({ mesh->lastDrawn, mesh.get(), nullptr });
+            }
+        }
+        for (const std::shared_ptr<SharedTexture> &texture : textures) {
+            // Textures without a file, such as those in a .glb, cannot be streamed in again
+            if (texture->resident && !texture->path.empty() && clock - texture->lastDrawn > idleSeconds) {
+                candidates.push_back({ texture->lastDrawn, nullptr, texture.get() });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Candidate &a, const Candidate &b) { return a.lastDrawn < b.lastDrawn; });
+
+        for (const Candidate &candidate : candidates) {
+            if (resident <= budgetBytes) {
+                break;
+            }
+            if (candidate.mesh) {
+                size_t bytes = candidate.mesh->gpuBytes;
+                candidate.mesh->evict();
+                resident -= bytes;
+                printf("Evicted mesh %s, %.1f KB, undrawn for %.1f s\n", candidate.mesh->path().c_str(),
+                       bytes / 1024.0, clock - candidate.lastDrawn);
+            } else {
+                size_t bytes = candidate.texture->bytes;
+                TextureStreamer::instance().evict(*candidate.texture);
+                resident -= bytes;
+                printf("Evicted texture %s, %.1f KB, undrawn for %.1f s\n", candidate.texture->path.c_str(),
+                       bytes / 1024.0, clock - candidate.lastDrawn);
+            }
+        }
+    }
+
+    // What is in use does not fit on its own, so the arrays give up their finest level.
+    // They take it back once a level four times the size fits. One step at a time, as
+    // the arrays only act on it once their copies are done
+    if (clock - adjustedAt < idleSeconds) {
+        return;
+    }
+    int coarsest = 0;
+    for (int size = arrays.layerSize; size > 1; size /= 2) {
+        coarsest++;
+    }
+    if (resident > budgetBytes && arrayBytes > 0 && arrays.finestLevel < coarsest) {
+        arrays.finestLevel++;
+        adjustedAt = clock;
+        printf("%.1f MB resident over a %.1f MB budget, texture arrays drop to level %d\n",
+               resident / 1048576.0, budgetBytes / 1048576.0, arrays.finestLevel);
+    } else if (arrays.finestLevel > 0 && resident + arrayBytes * 3 <= budgetBytes) {
+        arrays.finestLevel--;
+        adjustedAt = clock;
+        printf("%.1f MB resident under a %.1f MB budget, texture arrays may refine to level %d\n",
+               resident / 1048576.0, budgetBytes / 1048576.0, arrays.finestLevel);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+// Keeps the GPU memory of every mesh, texture and texture array under a budget.
+// Meshes and textures record when they were last drawn. Once the total is over
+// budget, the ones no frame has drawn for a while are evicted, least recently
+// drawn first, and restored from their cooked files when drawn again. When the
+// resources in use are over budget on their own, the texture arrays drop their
+// finest level until they fit, and take it back once there is room. Context
+// thread only
+class ResidencyManager {
+public:
+    // GPU bytes every mesh, texture and texture array may use together
+    size_t budgetBytes = 256u << 20;
+
+    // How long a resource goes undrawn before it can be evicted
+    double idleSeconds = 2.0;
+
+    static ResidencyManager& instance();
+
+    // Seconds on the clock of the last update, what draws are stamped with
+    double now() const { return clock; }
+
+    // GPU bytes in use after the last update
+    size_t residentBytes() const { return resident; }
+
+    // Evicts or coarsens until the total fits, once per frame before drawing
+    void update();
+
+private:
+    double clock = 0.0;
+    size_t resident = 0;
+    double adjustedAt = 0.0; // when the arrays last changed level, which takes them a while to act on
+};
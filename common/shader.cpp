@@ -13,78 +13,195 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "gl_extensions.hpp"
 
-unsigned int LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+namespace {
+
+// Lets the driver compile on as many threads as it likes, where it can
+void EnableParallelCompile(){
+    static bool Enabled = false;
+    if(!Enabled && hasExtension("GL_ARB_parallel_shader_compile")){
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    Enabled = true;
+}
+
+// Puts the defines after the #version line, which has to come first
+void InsertDefines(std::string &Code, const std::string &Defines){
+    if(Defines.empty()){
+        return;
+    }
+    size_t Position = 0;
+    if(Code.compare(0, 8, "#version") == 0){
+        Position = Code.find('\n');
+        Position = Position == std::string::npos ? Code.size() : Position + 1;
+    }
+    Code.insert(Position, Defines);
+}
+
+void StartCompile(ShaderBuild &Build, const ShaderSource &Source){
 
     // Create the shaders
-    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+    Build.VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+    Build.FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+    Build.FromBinary = false;
+
+    // Compile Vertex Shader
+    printf("Compiling shader : %s\n", Source.VertexPath.c_str());
+    char const * VertexSourcePointer = Source.VertexCode.c_str();
+    glShaderSource(Build.VertexShaderID, 1, &VertexSourcePointer , NULL);
+    glCompileShader(Build.VertexShaderID);
+
+    // Compile Fragment Shader
+    printf("Compiling shader : %s\n", Source.FragmentPath.c_str());
+    char const * FragmentSourcePointer = Source.FragmentCode.c_str();
+    glShaderSource(Build.FragmentShaderID, 1, &FragmentSourcePointer , NULL);
+    glCompileShader(Build.FragmentShaderID);
+
+    // Link the program, keeping its binary around when it can be cached
+    printf("Linking program\n");
+    Build.ProgramID = glCreateProgram();
+    glAttachShader(Build.ProgramID, Build.VertexShaderID);
+    glAttachShader(Build.ProgramID, Build.FragmentShaderID);
+    if(!Source.CachePath.empty()){
+        glProgramParameteri(Build.ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(Build.ProgramID);
+}
+
+}
+
+ShaderSource ReadShaderSource(const char * vertex_file_path,const char * fragment_file_path,
+                              const std::string &DriverKey, const std::string &Defines){
+
+    ShaderSource Source;
+    Source.VertexPath = vertex_file_path;
+    Source.FragmentPath = fragment_file_path;
 
     // Read the Vertex Shader code from the file
-    std::string VertexShaderCode;
     std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
     if(VertexShaderStream.is_open()){
         std::stringstream sstr;
         sstr << VertexShaderStream.rdbuf();
-        VertexShaderCode = sstr.str();
+        Source.VertexCode = sstr.str();
         VertexShaderStream.close();
     }else{
         printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-        getchar();
-        return 0;
+        return Source;
     }
 
     // Read the Fragment Shader code from the file
-    std::string FragmentShaderCode;
     std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
     if(FragmentShaderStream.is_open()){
         std::stringstream sstr;
         sstr << FragmentShaderStream.rdbuf();
-        FragmentShaderCode = sstr.str();
+        Source.FragmentCode = sstr.str();
         FragmentShaderStream.close();
     }
 
+    InsertDefines(Source.VertexCode, Defines);
+    InsertDefines(Source.FragmentCode, Defines);
+
+    // Look for the binary an earlier run linked from this code
+    if(!DriverKey.empty()){
+        Source.CacheKey = programCacheKey(DriverKey, { &Source.VertexCode, &Source.FragmentCode });
+        Source.CachePath = programCachePath(vertex_file_path, Source.CacheKey);
+        readProgramBinary(Source.CachePath.c_str(), Source.CacheKey, Source.Binary);
+    }
+
+    Source.Valid = true;
+    return Source;
+}
+
+unsigned int LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+
+    ShaderSource Source = ReadShaderSource(vertex_file_path, fragment_file_path, programDriverKey());
+    if(!Source.Valid){
+        getchar();
+        return 0;
+    }
+    return CompileShaders(Source);
+}
+
+AssetHandle<unsigned int> LoadShadersAsync(const char * vertex_file_path,const char * fragment_file_path,
+                                           const std::string &Defines){
+
+    // Read on a worker, compile and link on the context thread. Finishing is queued behind
+    // the programs started meanwhile, so the driver can build them all at once
+    EnableParallelCompile();
+    std::string VertexPath = vertex_file_path;
+    std::string FragmentPath = fragment_file_path;
+    std::string DriverKey = programDriverKey();
+    AssetLoader &Loader = AssetLoader::instance();
+    AssetHandle<ShaderSource> Source = Loader.async([VertexPath, FragmentPath, DriverKey, Defines]() {
+        return ReadShaderSource(VertexPath.c_str(), FragmentPath.c_str(), DriverKey, Defines);
+    });
+    AssetHandle<ShaderBuild> Build = Loader.upload([Source]() {
+        return Source.get().Valid ? StartShaders(Source.get()) : ShaderBuild();
+    }, { Source.dependency() });
+    return Loader.upload([Source, Build]() {
+        return Build.get().ProgramID != 0 ? FinishShaders(Build.get(), Source.get()) : 0u;
+    }, { Build.dependency() });
+}
+
+ShaderBuild StartShaders(const ShaderSource &Source){
+
+    ShaderBuild Build;
+    if(Source.Binary.data.empty()){
+        StartCompile(Build, Source);
+        return Build;
+    }
+    Build.ProgramID = glCreateProgram();
+    glProgramBinary(Build.ProgramID, Source.Binary.format, Source.Binary.data.data(),
+                    static_cast<GLsizei>(Source.Binary.data.size()));
+    Build.FromBinary = true;
+    return Build;
+}
+
+unsigned int CompileShaders(const ShaderSource &Source){
+    return FinishShaders(StartShaders(Source), Source);
+}
+
+unsigned int FinishShaders(ShaderBuild Build, const ShaderSource &Source){
+
+    const char * vertex_file_path = Source.VertexPath.c_str();
+    const char * fragment_file_path = Source.FragmentPath.c_str();
+
     GLint Result = GL_FALSE;
     int InfoLogLength;
 
-    // Compile Vertex Shader
-    printf("Compiling shader : %s\n", vertex_file_path);
-    char const * VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-    glCompileShader(VertexShaderID);
+    // A driver update or a different GPU rejects the binary, so compile after all
+    if(Build.FromBinary){
+        glGetProgramiv(Build.ProgramID, GL_LINK_STATUS, &Result);
+        if(Result == GL_TRUE){
+            printf("Loaded program binary for %s and %s\n", vertex_file_path, fragment_file_path);
+            return Build.ProgramID;
+        }
+        printf("Program binary %s was rejected, compiling\n", Source.CachePath.c_str());
+        glDeleteProgram(Build.ProgramID);
+        StartCompile(Build, Source);
+    }
 
     // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    glGetShaderiv(Build.VertexShaderID, GL_COMPILE_STATUS, &Result);
+    glGetShaderiv(Build.VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
     if ( InfoLogLength > 0 ){
         std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
+        glGetShaderInfoLog(Build.VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
         printf("%s\n", &VertexShaderErrorMessage[0]);
     }
 
-    // Compile Fragment Shader
-    printf("Compiling shader : %s\n", fragment_file_path);
-    char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-    glCompileShader(FragmentShaderID);
-
     // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    glGetShaderiv(Build.FragmentShaderID, GL_COMPILE_STATUS, &Result);
+    glGetShaderiv(Build.FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
     if ( InfoLogLength > 0 ){
         std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-        glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
+        glGetShaderInfoLog(Build.FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
         printf("%s\n", &FragmentShaderErrorMessage[0]);
     }
 
-    // Link the program
-    printf("Linking program\n");
-    GLuint ProgramID = glCreateProgram();
-    glAttachShader(ProgramID, VertexShaderID);
-    glAttachShader(ProgramID, FragmentShaderID);
-    glLinkProgram(ProgramID);
-
     // Check the program
+    GLuint ProgramID = Build.ProgramID;
     glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
     glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
     if ( InfoLogLength > 0 ){
@@ -93,12 +210,18 @@ unsigned int LoadShaders(const char * vertex_file_path,const char * fragment_fil
         printf("%s\n", &ProgramErrorMessage[0]);
     }
 
-    glDetachShader(ProgramID, VertexShaderID);
-    glDetachShader(ProgramID, FragmentShaderID);
+    glDetachShader(ProgramID, Build.VertexShaderID);
+    glDetachShader(ProgramID, Build.FragmentShaderID);
     
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
+    glDeleteShader(Build.VertexShaderID);
+    glDeleteShader(Build.FragmentShaderID);
+
+    // Cache the binary so the next run skips compiling
+    ProgramBinary Binary;
+    if(Result == GL_TRUE && !Source.CachePath.empty() && retrieveProgramBinary(ProgramID, Binary) &&
+       writeProgramBinary(Source.CachePath.c_str(), Source.CacheKey, Binary)){
+        printf("Cached program binary %s, %.1f KB\n", Source.CachePath.c_str(), Binary.data.size() / 1024.0);
+    }
 
     return ProgramID;
 }
-
@@ -6,5 +6,50 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <string>
 
+#include "asset_loader.hpp"
+#include "program_cache.hpp"
+
+// Vertex and fragment shader code, read without touching GL
+struct ShaderSource
+{
+    std::string VertexPath;
+    std::string FragmentPath;
+    std::string VertexCode;
+    std::string FragmentCode;
+    bool Valid = false;
+    
+    // Binary an earlier run linked from the same code on the same driver, read with
+    // the code. CachePath is empty when the driver cannot return binaries
+    std::string CachePath;
+    uint64_t CacheKey = 0;
+    ProgramBinary Binary;
+};
+
+// Program whose binary load, or compile and link, has been issued but not checked.
+// Checking later lets the driver build every program started meanwhile at once
+struct ShaderBuild
+{
+    GLuint ProgramID = 0;
+    GLuint VertexShaderID = 0;
+    GLuint FragmentShaderID = 0;
+    bool FromBinary = false;
+};
+
+// The driver key, from programDriverKey, finds the cached binary. Defines go after the
+// #version line of both stages, so one source builds several variants
+ShaderSource ReadShaderSource(const char *vertex_file_path, const char *fragment_file_path,
+                              const std::string &DriverKey = std::string(),
+                              const std::string &Defines = std::string());
+ShaderBuild StartShaders(const ShaderSource &Source);
+
+// Compiles instead when the driver rejects the binary, and caches the binary of what it compiled
+unsigned int FinishShaders(ShaderBuild Build, const ShaderSource &Source);
+unsigned int CompileShaders(const ShaderSource &Source);
 unsigned int LoadShaders(const char *vertex_file_path, const char *fragment_file_path);
+
+// Reads the files and cached binary on an AssetLoader worker, then starts and finishes
+// the program in separate jobs on the context thread. Call on the context thread
+AssetHandle<unsigned int> LoadShadersAsync(const char *vertex_file_path, const char *fragment_file_path,
+                                           const std::string &Defines = std::string());
@@ -0,0 +1,77 @@
+#include "shader_program.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+template <typename T> GLenum glslType();
+template <> GLenum glslType<int>() { return GL_INT; }
+template <> GLenum glslType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> GLenum glslType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> GLenum glslType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+struct UniformInfo {
+    const char* name;
+    GLenum type;
+};
+
+const UniformInfo uniformInfo[UNIFORM_COUNT] = {
+#define UNIFORM_INFO(name, type) { #name, glslType<type>() },
+    SHADER_UNIFORMS(UNIFORM_INFO)
+#undef UNIFORM_INFO
+};
+
+const char* uniformBlockNames[UNIFORM_BLOCK_COUNT] = { "LightBlock", "DrawBlock" };
+
+bool isSampler(GLenum type) {
+    return type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY;
+}
+
+}
+
+ShaderProgram::ShaderProgram(GLuint program) : program(program) {
+    for (GLint &location : locations) {
+        location = -1;
+    }
+    if (program == 0) {
+        return;
+    }
+
+    // Blocks are not bound in the source, which GLSL 3.30 has no layout for
+    for (int block = 0; block < UNIFORM_BLOCK_COUNT; block++) {
+        GLuint index = glGetUniformBlockIndex(program, uniformBlockNames[block]);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, index, static_cast<GLuint>(block));
+        }
+    }
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), maxLength + 1, nullptr, &size, &type, name.data());
+
+        // Arrays are listed by their first element, and set from it
+        size_t length = strlen(name.data());
+        if (length > 3 && strcmp(name.data() + length - 3, "[0]") == 0) {
+            name[length - 3] = '\0';
+        }
+        for (int id = 0; id < UNIFORM_COUNT; id++) {
+            if (strcmp(uniformInfo[id].name, name.data()) != 0) {
+                continue;
+            }
+            locations[id] = glGetUniformLocation(program, name.data());
+            bool matches = type == uniformInfo[id].type || (uniformInfo[id].type == GL_INT && isSampler(type));
+            if (!matches) {
+                printf("Uniform %s of program %u is declared as 0x%x but set as 0x%x\n", name.data(), program, type,
+                       uniformInfo[id].type);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Every uniform outside the uniform blocks, by its name in the shaders and the type
+// it is set with. Each becomes a typed handle in Uniforms, resolved to a location once
+// when a program is created, so the frame loop never looks a name up
+#define SHADER_UNIFORMS(X)           \
+    X(tint, glm::vec3)               \
+    X(diffuseMap, int)               \
+    X(normalMap, int)                \
+    X(specularMap, int)              \
+    X(diffuseMaps, int)              \
+    X(normalMaps, int)               \
+    X(specularMaps, int)             \
+    X(inverseProjection, glm::mat4)  \
+    X(viewport, glm::vec4)           \
+    X(lightColour, glm::vec3)        \
+    X(projection, glm::mat4)         \
+    X(text, int)                     \
+    X(textColour, glm::vec3)
+
+enum UniformId {
+#define UNIFORM_ID(name, type) UNIFORM_##name,
+    SHADER_UNIFORMS(UNIFORM_ID)
+#undef UNIFORM_ID
+    UNIFORM_COUNT
+};
+
+// Uniform blocks, each read from the buffer bound to the binding point of the same value
+enum UniformBlock {
+    LIGHT_BLOCK, // LightBlock, the scene's lights
+    DRAW_BLOCK,  // DrawBlock, what one draw is drawn with
+    UNIFORM_BLOCK_COUNT
+};
+
+// Everything a lit draw sets for itself, as the DrawBlock uniform block lays it out
+// under std140. Each draw writes its own to the UniformRing
+struct DrawBlock {
+    glm::mat4 MVP = glm::mat4(1.0f);
+    glm::mat4 MV = glm::mat4(1.0f);
+    glm::vec4 materialConstants[3] = { glm::vec4(0.5f), glm::vec4(0.5f, 0.5f, 1.0f, 1.0f), glm::vec4(0.5f) };
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    GLint packedVertex = 0; // a GLSL bool
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    float ka = 0.0f;
+    glm::vec3 modelTint = glm::vec3(1.0f);
+    float kd = 0.0f;
+    glm::ivec3 materialLayers = glm::ivec3(-2);
+    float ks = 0.0f;
+    float Ns = 0.0f;
+    float padding[3] = {};
+};
+static_assert(sizeof(DrawBlock) == 256, "DrawBlock must match the std140 DrawBlock block");
+
+// Uniform that can only be set with the type it is declared with. Samplers are ints
+template <typename T>
+struct ShaderUniform {
+    using Type = T;
+    UniformId id;
+};
+
+namespace Uniforms {
+#define UNIFORM_HANDLE(name, type) constexpr ShaderUniform<type> name{ UNIFORM_##name };
+SHADER_UNIFORMS(UNIFORM_HANDLE)
+#undef UNIFORM_HANDLE
+}
+
+// Linked program and the locations of its uniforms, read from its active uniforms once.
+// Uniforms a program does not use are set at location -1, which GL ignores
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+
+    // Reflects the active uniforms of a linked program and points its uniform blocks at
+    // their binding points. It does not take ownership of the program
+    explicit ShaderProgram(GLuint program);
+
+    GLuint id() const { return program; }
+
+    template <typename T>
+    bool has(ShaderUniform<T> uniform) const { return locations[uniform.id] >= 0; }
+
+    // The handle alone decides the type, so values convert to it
+    template <typename T>
+    void set(ShaderUniform<T> uniform, const typename ShaderUniform<T>::Type &value) const {
+        setUniform(locations[uniform.id], &value, 1);
+    }
+
+    // Sets the first count elements of an array
+    template <typename T>
+    void set(ShaderUniform<T> uniform, const typename ShaderUniform<T>::Type *values, GLsizei count) const {
+        setUniform(locations[uniform.id], values, count);
+    }
+
+private:
+    GLuint program = 0;
+    GLint locations[UNIFORM_COUNT] = {};
+
+    static void setUniform(GLint location, const int *values, GLsizei count) { glUniform1iv(location, count, values); }
+    static void setUniform(GLint location, const glm::vec3 *values, GLsizei count) {
+        glUniform3fv(location, count, &values[0][0]);
+    }
+    static void setUniform(GLint location, const glm::vec4 *values, GLsizei count) {
+        glUniform4fv(location, count, &values[0][0]);
+    }
+    static void setUniform(GLint location, const glm::mat4 *values, GLsizei count) {
+        glUniformMatrix4fv(location, count, GL_FALSE, &values[0][0][0]);
+    }
+};
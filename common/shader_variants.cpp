@@ -0,0 +1,111 @@
+#include "shader_variants.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "shader.hpp"
+
+uint32_t ShaderFeatures::key() const {
+    // Up to 255 lights of each type
+    return static_cast<uint32_t>(lights.point) | static_cast<uint32_t>(lights.spot) << 8 |
+           static_cast<uint32_t>(lights.directional) << 16 | (material.normalMap ? 1u << 24 : 0u) |
+           (material.specularMap ? 1u << 25 : 0u) | (viewSpaceLighting ? 1u << 26 : 0u);
+}
+
+std::string ShaderFeatures::defines() const {
+    // GLSL has no empty arrays, so a scene without lights still gets one slot
+    std::string code;
+    code += "#define POINT_LIGHTS " + std::to_string(lights.point) + "\n";
+    code += "#define SPOT_LIGHTS " + std::to_string(lights.spot) + "\n";
+    code += "#define DIRECTIONAL_LIGHTS " + std::to_string(lights.directional) + "\n";
+    code += "#define LIGHT_COUNT " + std::to_string(lights.total()) + "\n";
+    code += "#define LIGHT_SLOTS " + std::to_string(std::max(lights.total(), 1)) + "\n";
+    if (material.normalMap) {
+        code += "#define NORMAL_MAP\n";
+    }
+    if (material.specularMap) {
+        code += "#define SPECULAR_MAP\n";
+    }
+    if (viewSpaceLighting) {
+        code += "#define VIEW_SPACE_LIGHTING\n";
+    }
+    return code;
+}
+
+ShaderVariants::ShaderVariants(const char *vertexPath, const char *fragmentPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+ShaderVariants::Variant& ShaderVariants::variant(const ShaderFeatures &features) {
+    auto found = variants.find(features.key());
+    if (found != variants.end()) {
+        return found->second;
+    }
+    printf("Building shader variant: %d point, %d spot and %d directional lights, %s normal map, %s specular map, "
+           "lit in %s space\n", features.lights.point, features.lights.spot, features.lights.directional,
+           features.material.normalMap ? "with" : "without", features.material.specularMap ? "with" : "without",
+           features.viewSpaceLighting ? "view" : "tangent");
+    Variant &variant = variants[features.key()];
+    variant.build = LoadShadersAsync(vertexPath.c_str(), fragmentPath.c_str(), features.defines());
+    return variant;
+}
+
+void ShaderVariants::prepare(const ShaderFeatures &features) {
+    variant(features);
+}
+
+AssetLoader::Dependencies ShaderVariants::pending() const {
+    AssetLoader::Dependencies dependencies;
+    for (const auto &entry : variants) {
+        if (!entry.second.build.isReady()) {
+            dependencies.push_back(entry.second.build.dependency());
+        }
+    }
+    return dependencies;
+}
+
+const ShaderProgram& ShaderVariants::program(const ShaderFeatures &features) {
+    Variant &variant = this->variant(features);
+    if (!variant.build.isReady()) {
+        AssetLoader::instance().wait({ variant.build.dependency() });
+    }
+    if (!variant.reflected) {
+        variant.program = ShaderProgram(variant.build.get());
+        variant.reflected = true;
+    }
+    return variant.program;
+}
+
+void ShaderVariants::beginFrame(const LightCounts &lights) {
+    this->lights = lights;
+    frame++;
+    current = 0;
+}
+
+const ShaderProgram& ShaderVariants::use(const MaterialFeatures &material) {
+    ShaderFeatures features;
+    features.lights = lights;
+    features.material = material;
+    features.viewSpaceLighting = viewSpaceLighting;
+    Variant &variant = this->variant(features);
+    const ShaderProgram &program = this->program(features);
+    if (program.id() == current) {
+        return program;
+    }
+    glUseProgram(program.id());
+    current = program.id();
+    if (variant.frame != frame && perFrame) {
+        perFrame(program);
+    }
+    variant.frame = frame;
+    return program;
+}
+
+void ShaderVariants::release() {
+    for (auto &entry : variants) {
+        if (entry.second.build.isReady()) {
+            glDeleteProgram(entry.second.build.get());
+        }
+    }
+    variants.clear();
+    current = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "asset_loader.hpp"
+#include "shader_program.hpp"
+
+// Lights of each type in the scene, which a lit program loops over in this order
+struct LightCounts {
+    int point = 0;
+    int spot = 0;
+    int directional = 0;
+
+    int total() const { return point + spot + directional; }
+};
+
+// Maps a material samples. A map that is missing or one colour reads its constant instead
+struct MaterialFeatures {
+    bool normalMap = true;
+    bool specularMap = true;
+};
+
+// What a program variant is specialised on. Lighting is done per fragment either way,
+// in tangent space with every light transformed per vertex, or in view space with
+// only the tangent frame interpolated, which keeps the vertex outputs the same size
+// however many lights there are
+struct ShaderFeatures {
+    LightCounts lights;
+    MaterialFeatures material;
+    bool viewSpaceLighting = false;
+
+    uint32_t key() const;
+
+    // #define lines that select the variant from the shared source
+    std::string defines() const;
+};
+
+// Specialised programs built from one vertex and fragment source. Each variant gets
+// its features as #defines, so a fragment only evaluates the lights there are and
+// only samples the maps its material has. Variants prepared ahead of time build on
+// the AssetLoader alongside each other, others build the first time they are used.
+// Context thread only
+class ShaderVariants {
+public:
+    // Sets the uniforms every draw shares, such as the lights, on a program the first
+    // time it is used in a frame
+    std::function<void(const ShaderProgram&)> perFrame;
+
+    // Picks the lighting path of the variants use returns, can change between frames
+    bool viewSpaceLighting = false;
+
+    ShaderVariants(const char *vertexPath, const char *fragmentPath);
+
+    // Starts building the variant without waiting for it
+    void prepare(const ShaderFeatures &features);
+
+    // Variants still building, to wait on
+    AssetLoader::Dependencies pending() const;
+
+    // Program of the variant, built now if it was not prepared. Its id is 0 when it fails to build
+    const ShaderProgram& program(const ShaderFeatures &features);
+
+    // Lights every variant used this frame is specialised on
+    void beginFrame(const LightCounts &lights);
+
+    // Makes the variant for the frame's lights and the material current
+    const ShaderProgram& use(const MaterialFeatures &material);
+
+    void release();
+
+private:
+    struct Variant {
+        AssetHandle<unsigned int> build;
+        ShaderProgram program; // reflected once the build is done
+        bool reflected = false;
+        unsigned int frame = 0; // last frame perFrame ran for it
+    };
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::unordered_map<uint32_t, Variant> variants;
+    LightCounts lights;
+    unsigned int frame = 0;
+    GLuint current = 0;
+
+    Variant& variant(const ShaderFeatures &features);
+};
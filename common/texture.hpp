@@ -1,6 +1,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.hpp"
 #include <GL/glew.h>
+#include <algorithm>
+#include <vector>
+
+#include "mip_generator.hpp"
 
 unsigned int loadTexture(const char *path)
 {
@@ -9,25 +13,25 @@ unsigned int loadTexture(const char *path)
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
     
-    // Load texture image from file
+    // Load texture image from file, as RGBA for the mip filter
     int width, height, nChannels;
     stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(path, &width, &height, &nChannels, 0);
+    unsigned char *data = stbi_load(path, &width, &height, &nChannels, 4);
     
     if (data)
     {
-        // Deal with different number of colour channels
-        GLenum format;
-        if (nChannels == 1)
-            format = GL_RED;
-        else if (nChannels == 3)
-            format = GL_RGB;
-        else if (nChannels == 4)
-            format = GL_RGBA;
-        
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+        // Build the mip chain on the CPU instead of with glGenerateMipmap
+        std::vector<std::vector<unsigned char>> mips;
+        generateMips(data, width, height, MIP_SRGB, mips);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
                      GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        for (size_t i = 0; i < mips.size(); i++)
+        {
+            int level = static_cast<int>(i) + 1;
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, std::max(1, width >> level),
+                         std::max(1, height >> level), 0, GL_RGBA, GL_UNSIGNED_BYTE, mips[i].data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.size()));
         
         // Set texture wrapping options
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
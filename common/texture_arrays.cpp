@@ -0,0 +1,258 @@
+#include "texture_arrays.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "asset_registry.hpp"
+#include "texture_streamer.hpp"
+
+namespace {
+
+const char* usageNames[TEXTURE_USAGE_COUNT] = { "colour", "normal", "specular" };
+
+}
+
+TextureArrays& TextureArrays::instance() {
+    static TextureArrays textureArrays;
+    return textureArrays;
+}
+
+int TextureArrays::startLevel(const Array &array) const {
+    int level = 0;
+    while (level + 1 < array.levels && (layerSize >> level) > startSize) {
+        level++;
+    }
+    return level;
+}
+
+size_t TextureArrays::levelBytes(const Array &array, int level) const {
+    int size = std::max(1, layerSize >> level);
+    return array.blocks ? compressedSize(array.format, size, size) : static_cast<size_t>(size) * size * 4;
+}
+
+void TextureArrays::storeLevels(Array &array, int first, int last, bool allocate) {
+    // Zero sized levels give their storage back, the base level keeps them out of sampling
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    for (int level = first; level <= last; level++) {
+        int size = allocate ? std::max(1, layerSize >> level) : 0;
+        int depth = allocate ? layerCapacity : 0;
+        if (array.blocks) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, blockInternalFormat(array.format), size, size, depth, 0,
+                                   static_cast<GLsizei>(allocate ? levelBytes(array, level) * depth : 0), nullptr);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, depth, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         nullptr);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+size_t TextureArrays::residentBytes(const Array &array) const {
+    size_t bytes = 0;
+    for (int level = array.allocatedLevel; level < array.levels; level++) {
+        bytes += levelBytes(array, level) * layerCapacity;
+    }
+    return bytes;
+}
+
+size_t TextureArrays::residentBytes() const {
+    size_t bytes = 0;
+    for (const Array &array : arrays) {
+        bytes += array.texture != 0 ? residentBytes(array) : 0;
+    }
+    return bytes;
+}
+
+void TextureArrays::createArray(TextureUsage usage) {
+    Array &array = arrays[usage];
+    array.blocks = layerBlockFormat(usage, TextureStreamer::instance().supportsS3tc(), array.format);
+    array.levels = 0;
+    for (int size = layerSize; size > 0; size /= 2) {
+        array.levels++;
+    }
+    array.baseLevel = array.allocatedLevel = startLevel(array);
+    array.neededAt.assign(array.levels, -HUGE_VAL);
+    array.layers.reserve(layerCapacity);
+
+    // Only the coarse levels get storage, layers are filled as their maps stream in
+    glGenTextures(1, &array.texture);
+    storeLevels(array, array.baseLevel, array.levels - 1, true);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, array.baseLevel);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+    if (array.blocks && blockBaseFormat(array.format) == GL_RED) {
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    printf("Created %s texture array of %d %dx%d %s layers from level %d, %.1f KB\n", usageNames[usage],
+           layerCapacity, layerSize, layerSize, array.blocks ? blockFormatName(array.format) : "RGBA8",
+           array.baseLevel, residentBytes(array) / 1024.0);
+}
+
+std::shared_ptr<TextureLayer> TextureArrays::layer(const char *path, TextureUsage usage, const char *packedPath) {
+    Array &array = arrays[usage];
+    std::string key = AssetRegistry::canonicalPath(path);
+    if (packedPath) {
+        key += "+" + AssetRegistry::canonicalPath(packedPath);
+    }
+    auto found = array.files.find(key);
+    std::shared_ptr<TextureLayer> layer = found != array.files.end() ? found->second.lock() : nullptr;
+    if (layer) {
+        return layer;
+    }
+    layer = std::make_shared<TextureLayer>();
+    layer->path = path;
+    layer->packedPath = packedPath ? packedPath : "";
+    layer->usage = usage;
+
+    // A map cooked as one colour before never takes a layer
+    if (readConstantTexture(path, usage, layerSize, packedPath, layer->colour)) {
+        layer->constant = layer->resident = true;
+        layer->index = -1;
+        array.files[key] = layer;
+        printf("Texture %s is constant (%d, %d, %d, %d), the shader uses its colour\n", path, layer->colour[0],
+               layer->colour[1], layer->colour[2], layer->colour[3]);
+        return layer;
+    }
+
+    // Reuse the first layer no material holds any more, or take a new one
+    auto free = std::find_if(array.layers.begin(), array.layers.end(),
+                             [](const std::weak_ptr<TextureLayer> &held) { return held.expired(); });
+    int index = static_cast<int>(free - array.layers.begin());
+    if (index >= layerCapacity) {
+        printf("Texture array is full, %s gets a texture of its own\n", path);
+        return nullptr;
+    }
+    if (array.texture == 0) {
+        createArray(usage);
+    }
+    layer->index = index;
+    layer->residentLevel = array.levels;
+    layer->requestedLevel = array.allocatedLevel;
+    if (index < static_cast<int>(array.layers.size())) {
+        array.layers[index] = layer;
+    } else {
+        array.layers.push_back(layer);
+    }
+    array.files[key] = layer;
+    TextureStreamer::instance().streamLayer(path, usage, layer, array.texture, layerSize, array.allocatedLevel,
+                                            array.levels - 1);
+    return layer;
+}
+
+void TextureArrays::request(const TextureLayer &layer, float pixelsPerRepeat) {
+    Array &array = arrays[layer.usage];
+    if (array.texture == 0 || layer.constant || !(pixelsPerRepeat > 0.0f)) {
+        return;
+    }
+    // The level with about a texel per pixel, rounded down to the finer one
+    int level = static_cast<int>(std::floor(std::log2(layerSize / pixelsPerRepeat)));
+    array.neededAt[std::min(std::max(level, 0), array.levels - 1)] = now;
+}
+
+void TextureArrays::update() {
+    std::chrono::duration<double> clock = std::chrono::steady_clock::now().time_since_epoch();
+    now = clock.count();
+
+    for (int usage = 0; usage < TEXTURE_USAGE_COUNT; usage++) {
+        Array &array = arrays[usage];
+        if (array.texture == 0) {
+            continue;
+        }
+
+        // Finest level an object needed recently, the start level when none is close,
+        // but no finer than the budget allows
+        int wanted = startLevel(array);
+        for (int level = 0; level < wanted; level++) {
+            if (now - array.neededAt[level] < evictSeconds) {
+                wanted = level;
+                break;
+            }
+        }
+        wanted = std::min(std::max(wanted, finestLevel), array.levels - 1);
+        if (wanted < array.allocatedLevel) {
+            storeLevels(array, wanted, array.allocatedLevel - 1, true);
+            array.allocatedLevel = wanted;
+        }
+
+        // A layer asks for its missing levels once the ones it asked for before are in,
+        // so the levels it has are always contiguous
+        bool idle = true, complete = true;
+        for (std::weak_ptr<TextureLayer> &held : array.layers) {
+            std::shared_ptr<TextureLayer> layer = held.lock();
+            if (layer && layer->constant) {
+                // Cooked as one colour, so the layer is free for the next map
+                held.reset();
+                continue;
+            }
+            if (!layer || layer->missing) {
+                continue;
+            }
+            if (layer->residentLevel == layer->requestedLevel && layer->requestedLevel > array.allocatedLevel) {
+                TextureStreamer::instance().streamLayer(layer->path.c_str(), layer->usage, layer, array.texture,
+                                                        layerSize, array.allocatedLevel, layer->requestedLevel - 1);
+                layer->requestedLevel = array.allocatedLevel;
+            }
+            idle = idle && layer->residentLevel == layer->requestedLevel;
+            complete = complete && layer->residentLevel <= array.allocatedLevel;
+        }
+
+        if (array.allocatedLevel < array.baseLevel && complete) {
+            // Sample the finer levels now every layer has them
+            array.baseLevel = array.allocatedLevel;
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, array.baseLevel);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            printf("Texture array %s refined to level %d, %.1f KB resident\n", usageNames[usage], array.baseLevel,
+                   residentBytes(array) / 1024.0);
+        } else if (wanted > array.baseLevel && array.allocatedLevel == array.baseLevel && idle) {
+            // Nothing is copying into the finer levels, so their storage can go
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.texture);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, wanted);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            storeLevels(array, array.baseLevel, wanted - 1, false);
+            array.baseLevel = array.allocatedLevel = wanted;
+            for (const std::weak_ptr<TextureLayer> &held : array.layers) {
+                std::shared_ptr<TextureLayer> layer = held.lock();
+                if (!layer || layer->missing) {
+                    continue;
+                }
+                layer->residentLevel = std::max(layer->residentLevel, wanted);
+                layer->requestedLevel = std::max(layer->requestedLevel, wanted);
+                layer->bytes = 0;
+                for (int level = layer->residentLevel; level < array.levels; level++) {
+                    layer->bytes += levelBytes(array, level);
+                }
+            }
+            printf("Texture array %s evicted to level %d, %.1f KB resident\n", usageNames[usage], array.baseLevel,
+                   residentBytes(array) / 1024.0);
+        }
+    }
+}
+
+void TextureArrays::bind(const ShaderProgram &program) {
+    static const ShaderUniform<int> samplers[TEXTURE_USAGE_COUNT] = { Uniforms::diffuseMaps, Uniforms::normalMaps,
+                                                                      Uniforms::specularMaps };
+    for (int usage = 0; usage < TEXTURE_USAGE_COUNT; usage++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + usage);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[usage].texture);
+        program.set(samplers[usage], firstUnit + usage);
+    }
+    // Maps bound on their own and the streamer expect the first unit to be active
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void TextureArrays::release() {
+    for (Array &array : arrays) {
+        glDeleteTextures(1, &array.texture);
+        array = Array();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "shader_program.hpp"
+#include "texture_cooker.hpp"
+
+// One material map held in a layer of a texture array, freed with its last reference
+struct TextureLayer {
+    std::string path;
+    std::string packedPath; // map cooked into alpha, the specular map of a colour layer
+    TextureUsage usage = TEXTURE_COLOUR;
+    int index = 0;
+    size_t bytes = 0;
+    double loadMilliseconds = 0.0;
+    bool resident = false; // false while streaming, the shader then uses the usage's placeholder
+    bool missing = false;  // the file could not be streamed in, so it keeps the placeholder
+    int residentLevel = 0; // finest level on the GPU, the level count before the first one is
+    int requestedLevel = 0; // finest level asked of the TextureStreamer
+    bool constant = false; // the map is one colour, which the shader uses instead of a layer
+    unsigned char colour[4] = {};
+};
+
+// Material maps packed into one GL_TEXTURE_2D_ARRAY per usage, so every material
+// is drawn with the same textures bound and only picks its layers. Maps are
+// resized to the layer size when cooked, and every array holds one format: BC3
+// colour with the material's specular map in alpha, BC5 normals and BC4 specular
+// for maps that are not packed. A freed layer is reused by the next map, and maps
+// of a single colour give their layer up once cooked, the shader using the colour.
+// Arrays start with only their coarse levels. Objects request the level their
+// distance calls for every frame, and the array's base level moves down once
+// every layer has the finer levels, and back up once no object has needed them
+// for a while. Context thread only
+class TextureArrays {
+public:
+    // Width and height of every layer, and layers per array. Both are fixed once an array exists
+    int layerSize = 1024;
+    int layerCapacity = 8;
+
+    // Widest level a new array starts from, and how long finer levels stay once unneeded
+    int startSize = 64;
+    double evictSeconds = 5.0;
+
+    // Finest level any array keeps, raised by the ResidencyManager while over its budget
+    int finestLevel = 0;
+
+    // Texture units the arrays are bound to, after the units of maps bound on their own
+    static const int firstUnit = 8;
+
+    static TextureArrays& instance();
+
+    // Layer streaming the file in, shared by every material using the file the same way.
+    // A packed map is cooked into the layer's alpha. nullptr when the array is full, the
+    // map then needs a texture of its own
+    std::shared_ptr<TextureLayer> layer(const char *path, TextureUsage usage, const char *packedPath = nullptr);
+
+    // Asks for the level an object needs when one repeat of its texture spans the given pixels
+    void request(const TextureLayer &layer, float pixelsPerRepeat);
+
+    // Streams in the levels objects asked for and frees the ones they stopped asking for,
+    // once per frame
+    void update();
+
+    // GPU bytes of every array
+    size_t residentBytes() const;
+
+    // Binds the arrays and points the shader's samplers at them, once per frame after glUseProgram
+    void bind(const ShaderProgram &program);
+
+    // Frees the arrays, call before the context goes away
+    void release();
+
+private:
+    struct Array {
+        GLuint texture = 0;
+        std::vector<std::weak_ptr<TextureLayer>> layers;
+        std::unordered_map<std::string, std::weak_ptr<TextureLayer>> files;
+        BlockFormat format = BLOCK_BC1;
+        bool blocks = false;
+        int levels = 0;
+        int baseLevel = 0;      // finest level sampled
+        int allocatedLevel = 0; // finest level with storage, below the base while it streams in
+        std::vector<double> neededAt; // when an object last needed each level, in seconds
+    };
+
+    Array arrays[TEXTURE_USAGE_COUNT];
+    double now = 0.0;
+
+    void createArray(TextureUsage usage);
+    int startLevel(const Array &array) const;
+    size_t levelBytes(const Array &array, int level) const;
+    // Allocates storage for every layer of the levels, or frees it
+    void storeLevels(Array &array, int first, int last, bool allocate);
+    size_t residentBytes(const Array &array) const;
+};
@@ -0,0 +1,320 @@
+#include "texture_cooker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "block_compression.hpp"
+#include "stb_image.hpp"
+
+namespace {
+
+// Channels of a constant texture may differ by this many steps, as they do in dithered or lossy images
+const int constantTolerance = 2;
+
+bool chooseFormat(const unsigned char *rgba, size_t pixels, TextureUsage usage, bool allowS3tc, BlockFormat &format) {
+    if (usage == TEXTURE_NORMAL) {
+        format = BLOCK_BC5;
+        return true;
+    }
+    bool opaque = true, greyscale = true;
+    for (size_t i = 0; i < pixels; i++) {
+        const unsigned char *pixel = rgba + i * 4;
+        opaque = opaque && pixel[3] == 255;
+        greyscale = greyscale && abs(pixel[0] - pixel[1]) <= 4 && abs(pixel[0] - pixel[2]) <= 4;
+    }
+    if (usage == TEXTURE_SPECULAR && greyscale) {
+        format = BLOCK_BC4;
+        return true;
+    }
+    format = opaque ? BLOCK_BC1 : BLOCK_BC3;
+    return allowS3tc;
+}
+
+// Bilinear resize of RGBA texels, sampling at texel centres
+std::vector<unsigned char> resample(const unsigned char *rgba, int width, int height, int targetWidth, int targetHeight) {
+    std::vector<unsigned char> target(static_cast<size_t>(targetWidth) * targetHeight * 4);
+    for (int y = 0; y < targetHeight; y++) {
+        float sourceY = std::max((y + 0.5f) * height / targetHeight - 0.5f, 0.0f);
+        int y0 = std::min(static_cast<int>(sourceY), height - 1), y1 = std::min(y0 + 1, height - 1);
+        float fy = sourceY - y0;
+        for (int x = 0; x < targetWidth; x++) {
+            float sourceX = std::max((x + 0.5f) * width / targetWidth - 0.5f, 0.0f);
+            int x0 = std::min(static_cast<int>(sourceX), width - 1), x1 = std::min(x0 + 1, width - 1);
+            float fx = sourceX - x0;
+            for (int c = 0; c < 4; c++) {
+                float top = rgba[(static_cast<size_t>(y0) * width + x0) * 4 + c] * (1.0f - fx) +
+                            rgba[(static_cast<size_t>(y0) * width + x1) * 4 + c] * fx;
+                float bottom = rgba[(static_cast<size_t>(y1) * width + x0) * 4 + c] * (1.0f - fx) +
+                               rgba[(static_cast<size_t>(y1) * width + x1) * 4 + c] * fx;
+                target[(static_cast<size_t>(y) * targetWidth + x) * 4 + c] =
+                    static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    return target;
+}
+
+// Mid range colour when every channel stays within the tolerance over the whole image
+bool constantColour(const unsigned char *rgba, size_t pixels, unsigned char colour[4]) {
+    unsigned char low[4] = { 255, 255, 255, 255 }, high[4] = {};
+    for (size_t i = 0; i < pixels; i++) {
+        for (int c = 0; c < 4; c++) {
+            low[c] = std::min(low[c], rgba[i * 4 + c]);
+            high[c] = std::max(high[c], rgba[i * 4 + c]);
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        if (high[c] - low[c] > constantTolerance) {
+            return false;
+        }
+        colour[c] = static_cast<unsigned char>((low[c] + high[c] + 1) / 2);
+    }
+    return true;
+}
+
+// Every level is the size its format and dimensions call for, and a layer is
+// the size and format of its array. Constant textures fit any layer
+bool levelsMatch(const KtxInfo &info, bool allowS3tc, TextureUsage usage, int layerSize) {
+    if (isConstantTexture(info)) {
+        return info.levels[0].size == 4;
+    }
+    BlockFormat format = BLOCK_BC1;
+    bool blocks = info.type == 0;
+    if (layerSize > 0) {
+        BlockFormat layerFormat = BLOCK_BC1;
+        bool layerBlocks = layerBlockFormat(usage, allowS3tc, layerFormat);
+        if (info.width != layerSize || info.height != layerSize || blocks != layerBlocks ||
+            (blocks && info.internalFormat != blockInternalFormat(layerFormat))) {
+            return false;
+        }
+    }
+    if (blocks && (!blockFormatOf(info.internalFormat, format) || info.baseFormat != blockBaseFormat(format) ||
+                   (!allowS3tc && (format == BLOCK_BC1 || format == BLOCK_BC3)))) {
+        return false;
+    }
+    if (!blocks && (info.internalFormat != GL_RGBA8 || info.format != GL_RGBA || info.type != GL_UNSIGNED_BYTE)) {
+        return false;
+    }
+    for (const KtxLevel &level : info.levels) {
+        size_t size = blocks ? compressedSize(format, level.width, level.height)
+                             : static_cast<size_t>(level.width) * level.height * 4;
+        if (level.size != size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Mip chain of RGBA pixels in the format the usage and driver call for, levels back to back
+void cookLevels(std::vector<unsigned char> image, int width, int height, TextureUsage usage, bool allowS3tc,
+                int layerSize, KtxInfo &info, std::vector<unsigned char> &data) {
+    // A constant texture keeps a single RGBA texel, which the shader can use instead of sampling
+    unsigned char colour[4];
+    if (constantColour(image.data(), static_cast<size_t>(width) * height, colour)) {
+        info = KtxInfo();
+        info.internalFormat = GL_RGBA8;
+        info.baseFormat = info.format = GL_RGBA;
+        info.type = GL_UNSIGNED_BYTE;
+        info.width = info.height = 1;
+        KtxLevel level;
+        level.width = level.height = 1;
+        level.size = info.dataSize = 4;
+        info.levels.push_back(level);
+        data.assign(colour, colour + 4);
+        return;
+    }
+    if (layerSize > 0 && (width != layerSize || height != layerSize)) {
+        // Halve with the mip filter first so the bilinear step never skips texels
+        while (width >= 2 * layerSize && height >= 2 * layerSize) {
+            std::vector<unsigned char> half(static_cast<size_t>(width / 2) * (height / 2) * 4);
+            downsampleLevel(image.data(), width, height, half.data(), mipFilterFor(usage));
+            image.swap(half);
+            width /= 2;
+            height /= 2;
+        }
+        image = resample(image.data(), width, height, layerSize, layerSize);
+        width = height = layerSize;
+    }
+    const unsigned char *pixels = image.data();
+    std::vector<std::vector<unsigned char>> mips;
+    generateMips(pixels, width, height, mipFilterFor(usage), mips);
+
+    // Without a block format the driver can sample, the levels are stored as RGBA
+    BlockFormat format = BLOCK_BC1;
+    bool blocks = layerSize > 0 ? layerBlockFormat(usage, allowS3tc, format)
+                                : chooseFormat(pixels, static_cast<size_t>(width) * height, usage, allowS3tc, format);
+    info = KtxInfo();
+    info.internalFormat = blocks ? blockInternalFormat(format) : GL_RGBA8;
+    info.baseFormat = blocks ? blockBaseFormat(format) : GL_RGBA;
+    info.format = blocks ? 0 : GL_RGBA;
+    info.type = blocks ? 0 : GL_UNSIGNED_BYTE;
+    info.width = width;
+    info.height = height;
+    data.clear();
+    for (size_t i = 0; i <= mips.size(); i++) {
+        const unsigned char *texels = i == 0 ? pixels : mips[i - 1].data();
+        KtxLevel level;
+        level.width = std::max(1, width >> i);
+        level.height = std::max(1, height >> i);
+        level.size = blocks ? compressedSize(format, level.width, level.height)
+                            : static_cast<size_t>(level.width) * level.height * 4;
+        data.resize(info.dataSize + level.size);
+        if (blocks) {
+            compressImage(texels, level.width, level.height, format, data.data() + info.dataSize);
+        } else {
+            memcpy(data.data() + info.dataSize, texels, level.size);
+        }
+        info.levels.push_back(level);
+        info.dataSize += level.size;
+    }
+}
+
+void reportCooked(const char *name, const KtxInfo &info, size_t uncompressedBytes,
+                  std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    BlockFormat format;
+    printf("Cooked %s as %s with %zu levels: %.1f KB from %.1f KB in %.2f ms\n", name,
+           blockFormatOf(info.internalFormat, format) ? blockFormatName(format) : "RGBA8", info.levels.size(),
+           info.dataSize / 1024.0, uncompressedBytes / 1024.0, elapsed.count());
+}
+
+}
+
+MipFilter mipFilterFor(TextureUsage usage) {
+    if (usage == TEXTURE_NORMAL)
+        return MIP_NORMAL;
+    else if (usage == TEXTURE_COLOUR)
+        return MIP_SRGB;
+    return MIP_LINEAR;
+}
+
+std::string cookedTexturePath(const char *path, TextureUsage usage, int layerSize, const char *packedPath) {
+    static const char* suffixes[TEXTURE_USAGE_COUNT] = { ".colour", ".normal", ".specular" };
+    std::string cookedPath = std::string(path) + suffixes[usage];
+    if (packedPath) {
+        cookedPath += "+" + std::filesystem::path(packedPath).filename().string();
+    }
+    if (layerSize > 0) {
+        cookedPath += "." + std::to_string(layerSize);
+    }
+    return cookedPath + ".ktx";
+}
+
+bool layerBlockFormat(TextureUsage usage, bool allowS3tc, BlockFormat &format) {
+    // Colour layers keep alpha for the specular map packed into it
+    format = usage == TEXTURE_NORMAL ? BLOCK_BC5 : usage == TEXTURE_SPECULAR ? BLOCK_BC4 : BLOCK_BC3;
+    return format != BLOCK_BC3 || allowS3tc;
+}
+
+bool isConstantTexture(const KtxInfo &info) {
+    return info.width == 1 && info.height == 1 && info.levels.size() == 1 && info.type == GL_UNSIGNED_BYTE &&
+           info.format == GL_RGBA;
+}
+
+bool cookTexture(const char *sourcePath, const char *cookedPath, TextureUsage usage, bool allowS3tc, int layerSize,
+                 const char *packedPath) {
+    auto start = std::chrono::steady_clock::now();
+    int width, height, components;
+    unsigned char *decoded = stbi_load(sourcePath, &width, &height, &components, 4);
+    if (!decoded) {
+        return false;
+    }
+    std::vector<unsigned char> image(decoded, decoded + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(decoded);
+    size_t sourceBytes = static_cast<size_t>(width) * height * components;
+
+    // The packed map's grey goes into alpha, resized to the image when they differ
+    if (packedPath) {
+        int packedWidth, packedHeight, packedComponents;
+        unsigned char *grey = stbi_load(packedPath, &packedWidth, &packedHeight, &packedComponents, 1);
+        if (!grey) {
+            return false;
+        }
+        std::vector<unsigned char> alpha = expandToRgba(grey, packedWidth, packedHeight, 1);
+        stbi_image_free(grey);
+        if (packedWidth != width || packedHeight != height) {
+            alpha = resample(alpha.data(), packedWidth, packedHeight, width, height);
+        }
+        for (size_t i = 0; i < image.size() / 4; i++) {
+            image[i * 4 + 3] = alpha[i * 4];
+        }
+        sourceBytes += static_cast<size_t>(packedWidth) * packedHeight * packedComponents;
+    }
+
+    KtxInfo info;
+    std::vector<unsigned char> data;
+    cookLevels(std::move(image), width, height, usage, allowS3tc, layerSize, info, data);
+    if (!writeKtx(cookedPath, sourcePath, info, data.data(), packedPath)) {
+        return false;
+    }
+    reportCooked(cookedPath, info, sourceBytes * 4 / 3, start);
+    return true;
+}
+
+std::vector<unsigned char> expandToRgba(const unsigned char *pixels, int width, int height, int components) {
+    std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < rgba.size() / 4; i++) {
+        const unsigned char *texel = pixels + i * components;
+        rgba[i * 4 + 0] = texel[0];
+        rgba[i * 4 + 1] = components >= 3 ? texel[1] : texel[0];
+        rgba[i * 4 + 2] = components >= 3 ? texel[2] : texel[0];
+        rgba[i * 4 + 3] = components == 4 ? texel[3] : components == 2 ? texel[1] : 255;
+    }
+    return rgba;
+}
+
+std::string cachedTexturePath(const char *ownerPath, const SourceStamp &content, TextureUsage usage) {
+    static const char* suffixes[TEXTURE_USAGE_COUNT] = { ".colour", ".normal", ".specular" };
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx-%llx", static_cast<unsigned long long>(content.hash),
+             static_cast<unsigned long long>(content.size));
+    std::filesystem::path path = std::filesystem::path(ownerPath).parent_path() / "texture_cache" / name;
+    return path.string() + suffixes[usage] + ".ktx";
+}
+
+bool readCachedTexture(const char *cachedPath, const SourceStamp &content, TextureUsage usage, bool allowS3tc,
+                       KtxInfo &info) {
+    SourceStamp cookedFrom;
+    return readKtxInfo(cachedPath, info, cookedFrom) && cookedFrom.size == content.size &&
+           cookedFrom.hash == content.hash && levelsMatch(info, allowS3tc, usage, 0);
+}
+
+bool cookPixels(const char *name, const unsigned char *pixels, int width, int height, int components,
+                const SourceStamp &content, const char *cookedPath, TextureUsage usage, bool allowS3tc) {
+    auto start = std::chrono::steady_clock::now();
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cookedPath).parent_path(), error);
+    KtxInfo info;
+    std::vector<unsigned char> data;
+    cookLevels(expandToRgba(pixels, width, height, components), width, height, usage, allowS3tc, 0, info, data);
+    if (!writeKtx(cookedPath, content, info, data.data())) {
+        return false;
+    }
+    reportCooked(name, info, static_cast<size_t>(width) * height * components * 4 / 3, start);
+    return true;
+}
+
+bool loadCookedTexture(const char *path, TextureUsage usage, bool allowS3tc, std::string &cookedPath, KtxInfo &info,
+                       int layerSize, const char *packedPath) {
+    cookedPath = cookedTexturePath(path, usage, layerSize, packedPath);
+    if (readKtxInfo(cookedPath.c_str(), path, info, packedPath) && levelsMatch(info, allowS3tc, usage, layerSize)) {
+        return true;
+    }
+    return cookTexture(path, cookedPath.c_str(), usage, allowS3tc, layerSize, packedPath) &&
+           readKtxInfo(cookedPath.c_str(), path, info, packedPath) && levelsMatch(info, allowS3tc, usage, layerSize);
+}
+
+bool readConstantTexture(const char *path, TextureUsage usage, int layerSize, const char *packedPath,
+                         unsigned char colour[4]) {
+    std::string cookedPath = cookedTexturePath(path, usage, layerSize, packedPath);
+    KtxInfo info;
+    return readKtxInfo(cookedPath.c_str(), path, info, packedPath) && isConstantTexture(info) &&
+           info.levels[0].size == 4 && readKtxLevels(cookedPath.c_str(), info, colour);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "block_compression.hpp"
+#include "ktx_file.hpp"
+#include "mip_generator.hpp"
+
+// What a material samples from a texture, which decides how it is compressed
+enum TextureUsage { TEXTURE_COLOUR, TEXTURE_NORMAL, TEXTURE_SPECULAR, TEXTURE_USAGE_COUNT };
+
+// Colour maps are filtered as sRGB, normal maps renormalised, anything else as it is
+MipFilter mipFilterFor(TextureUsage usage);
+
+// Cooked textures sit next to their source, one per usage, layer size and packed map
+std::string cookedTexturePath(const char *path, TextureUsage usage, int layerSize = 0,
+                              const char *packedPath = nullptr);
+
+// Block format every layer of a texture array for the usage is cooked to, false
+// when layers are stored as RGBA because the driver cannot sample S3TC
+bool layerBlockFormat(TextureUsage usage, bool allowS3tc, BlockFormat &format);
+
+// A texture whose texels are all the same colour is cooked to a single RGBA texel
+bool isConstantTexture(const KtxInfo &info);
+
+// Builds the mip chain on the CPU and block compresses every level into a KTX file.
+// Colour goes to BC1, or BC3 when it has alpha, normals to BC5 and greyscale specular
+// to BC4. Colour the driver cannot sample as S3TC is stored as RGBA instead. A layer
+// size resizes the image to a square of that size in its array's layer format. A
+// packed map, such as the specular map of a colour layer, goes into alpha as grey
+bool cookTexture(const char *sourcePath, const char *cookedPath, TextureUsage usage, bool allowS3tc,
+                 int layerSize = 0, const char *packedPath = nullptr);
+
+// Expands 8 bit pixels with 1 to 4 components to RGBA, grey going to every colour channel
+std::vector<unsigned char> expandToRgba(const unsigned char *pixels, int width, int height, int components);
+
+// Images without a file of their own, such as those embedded in a .glb, are cooked into
+// a texture_cache directory next to the file holding them. Files are named after the
+// hash of the encoded image, so files in one directory sharing an image cook it once
+std::string cachedTexturePath(const char *ownerPath, const SourceStamp &content, TextureUsage usage);
+
+// Header of a cached texture, only valid when it was cooked from the same content
+bool readCachedTexture(const char *cachedPath, const SourceStamp &content, TextureUsage usage, bool allowS3tc,
+                       KtxInfo &info);
+
+// Cooks decoded pixels as cookTexture does, stamped with the content they were decoded from
+bool cookPixels(const char *name, const unsigned char *pixels, int width, int height, int components,
+                const SourceStamp &content, const char *cookedPath, TextureUsage usage, bool allowS3tc);
+
+// Header of the cooked texture, cooking it first when it is missing or stale. False
+// when the source cannot be read or the cooked file cannot be written
+bool loadCookedTexture(const char *path, TextureUsage usage, bool allowS3tc, std::string &cookedPath, KtxInfo &info,
+                       int layerSize = 0, const char *packedPath = nullptr);
+
+// Colour of a texture already cooked as constant, false when it is not or not cooked yet
+bool readConstantTexture(const char *path, TextureUsage usage, int layerSize, const char *packedPath,
+                         unsigned char colour[4]);
@@ -0,0 +1,375 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "block_compression.hpp"
+#include "gl_extensions.hpp"
+#include "stb_image.hpp"
+
+TextureStreamer& TextureStreamer::instance() {
+    static TextureStreamer streamer;
+    return streamer;
+}
+
+GLuint TextureStreamer::placeholderTexture(TextureUsage usage) {
+    if (placeholders[usage] == 0) {
+        // Mid grey, or a normal pointing straight out of the surface
+        static const unsigned char colours[TEXTURE_USAGE_COUNT][4] = {
+            { 128, 128, 128, 255 },
+            { 128, 128, 255, 255 },
+            { 128, 128, 128, 255 },
+        };
+        glGenTextures(1, &placeholders[usage]);
+        glBindTexture(GL_TEXTURE_2D, placeholders[usage]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colours[usage]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    return placeholders[usage];
+}
+
+bool TextureStreamer::supportsS3tc() {
+    if (s3tcSupport < 0) {
+        s3tcSupport = hasExtension("GL_EXT_texture_compression_s3tc") ? 1 : 0;
+    }
+    return s3tcSupport == 1;
+}
+
+std::shared_ptr<SharedTexture> TextureStreamer::stream(const char *path, TextureUsage usage) {
+    auto texture = std::make_shared<SharedTexture>();
+    texture->path = path;
+    texture->usage = usage;
+    texture->evicted = true;
+    reload(texture);
+    return texture;
+}
+
+void TextureStreamer::evict(SharedTexture &texture) {
+    if (!texture.resident || texture.path.empty()) {
+        return;
+    }
+    glDeleteTextures(1, &texture.id);
+    texture.id = placeholderTexture(texture.usage);
+    texture.resident = false;
+    texture.evicted = true;
+    texture.bytes = 0;
+}
+
+void TextureStreamer::reload(const std::shared_ptr<SharedTexture> &texture) {
+    if (!texture->evicted) {
+        return;
+    }
+    texture->id = placeholderTexture(texture->usage);
+    texture->resident = false;
+    texture->evicted = false;
+
+    auto upload = std::make_shared<Upload>();
+    upload->target = texture;
+    upload->path = texture->path;
+    upload->start = std::chrono::steady_clock::now();
+    load(upload, texture->usage);
+}
+
+void TextureStreamer::streamLayer(const char *path, TextureUsage usage, const std::shared_ptr<TextureLayer> &layer,
+                                  GLuint array, int layerSize, int firstLevel, int lastLevel) {
+    auto upload = std::make_shared<Upload>();
+    upload->layer = layer;
+    upload->array = array;
+    upload->layerSize = layerSize;
+    upload->firstLevel = upload->level = firstLevel;
+    upload->lastLevel = lastLevel;
+    upload->path = path;
+    upload->packedPath = layer->packedPath;
+    upload->start = std::chrono::steady_clock::now();
+    load(upload, usage);
+}
+
+void TextureStreamer::load(const std::shared_ptr<Upload> &upload, TextureUsage usage) {
+    // The header sizes the pixel buffer, which has to be created and mapped on
+    // the context thread before a worker can decode into it. Cooking a missing
+    // or stale KTX file happens here too, falling back to the plain image when
+    // it cannot be written
+    AssetLoader &loader = AssetLoader::instance();
+    bool allowS3tc = supportsS3tc();
+    AssetHandle<bool> header = loader.async([upload, usage, allowS3tc]() {
+        if (stbi_info(upload->path.c_str(), &upload->width, &upload->height, &upload->components) != 1) {
+            return false;
+        }
+        upload->cooked = loadCookedTexture(upload->path.c_str(), usage, allowS3tc, upload->cookedPath, upload->ktx,
+                                           upload->layerSize,
+                                           upload->packedPath.empty() ? nullptr : upload->packedPath.c_str());
+        // A layer only takes the cooked chain, which matches its array, or the colour of a constant map
+        if (upload->array == 0) {
+            upload->lastLevel = upload->cooked ? static_cast<int>(upload->ktx.levels.size()) - 1 : 0;
+            return true;
+        }
+        if (upload->cooked && isConstantTexture(upload->ktx)) {
+            upload->constant = true;
+            return readKtxLevels(upload->cookedPath.c_str(), upload->ktx, upload->colour);
+        }
+        return upload->cooked && upload->lastLevel < static_cast<int>(upload->ktx.levels.size());
+    });
+    AssetHandle<unsigned char*> mapped = loader.upload([upload, header]() -> unsigned char* {
+        if (!header.get() || upload->constant) {
+            return nullptr;
+        }
+        size_t size = upload->cooked ? upload->levelsSize()
+                                     : static_cast<size_t>(upload->width) * upload->height * upload->components;
+        glGenBuffers(1, &upload->buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        void *pointer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return static_cast<unsigned char*>(pointer);
+    }, { header.dependency() });
+    AssetHandle<bool> decoded = loader.async([upload, mapped]() {
+        if (!mapped.get()) {
+            return upload->constant;
+        }
+        // Cooked levels are read straight into the mapping
+        if (upload->cooked) {
+            return readKtxLevels(upload->cookedPath.c_str(), upload->ktx, mapped.get(), upload->firstLevel,
+                                 upload->lastLevel);
+        }
+        // stb_image allocates its own output, so it is copied into the mapping
+        int width, height, components;
+        unsigned char *pixels = stbi_load(upload->path.c_str(), &width, &height, &components, upload->components);
+        bool valid = pixels && width == upload->width && height == upload->height;
+        if (valid) {
+            memcpy(mapped.get(), pixels, static_cast<size_t>(width) * height * upload->components);
+        }
+        stbi_image_free(pixels);
+        return valid;
+    }, { mapped.dependency() });
+    AssetHandle<bool> queued = loader.upload([this, upload, decoded]() {
+        bool valid = decoded.get();
+        if (upload->buffer != 0) {
+            // Unmapping fails if the buffer's contents were lost meanwhile
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->buffer);
+            valid = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE && valid;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        if (!valid) {
+            printf("Texture %s failed to load.\n", upload->path.c_str());
+            if (std::shared_ptr<TextureLayer> layer = upload->layer.lock()) {
+                layer->missing = true;
+            }
+            discard(*upload);
+            return false;
+        }
+        if (upload->constant) {
+            // The shader uses the colour, and TextureArrays frees the layer
+            if (std::shared_ptr<TextureLayer> layer = upload->layer.lock()) {
+                std::copy(upload->colour, upload->colour + 4, layer->colour);
+                layer->constant = layer->resident = true;
+                layer->bytes = 0;
+                printf("Texture %s is constant (%d, %d, %d, %d), the shader uses its colour\n", upload->path.c_str(),
+                       layer->colour[0], layer->colour[1], layer->colour[2], layer->colour[3]);
+            }
+            return true;
+        }
+        uploads.push_back(upload);
+        return true;
+    }, { decoded.dependency() });
+    decodes.push_back(queued.dependency());
+}
+
+void TextureStreamer::createTexture(Upload &upload) {
+    glGenTextures(1, &upload.texture);
+    glBindTexture(GL_TEXTURE_2D, upload.texture);
+    if (upload.cooked) {
+        // Every level is allocated up front, the cooked chain replaces glGenerateMipmap
+        const KtxInfo &ktx = upload.ktx;
+        for (size_t i = 0; i < ktx.levels.size(); i++) {
+            const KtxLevel &level = ktx.levels[i];
+            if (ktx.type == 0) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), ktx.internalFormat, level.width,
+                                       level.height, 0, static_cast<GLsizei>(level.size), nullptr);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), ktx.internalFormat, level.width, level.height, 0,
+                             ktx.format, ktx.type, nullptr);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(ktx.levels.size()) - 1);
+    } else {
+        GLenum format = textureFormat(upload.components);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, upload.width, upload.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    // Single channel maps read the same value in rgb, as they did when uploaded as greyscale
+    if (upload.cooked ? upload.ktx.baseFormat == GL_RED : upload.components == 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureStreamer::update() {
+    decodes.erase(std::remove_if(decodes.begin(), decodes.end(),
+                                 [](const std::shared_ptr<AssetState> &decode) { return decode->isReady(); }),
+                  decodes.end());
+
+    // Copy bands of rows out of the pixel buffers until the budget is spent
+    size_t budget = budgetBytes;
+    while (!uploads.empty() && budget > 0) {
+        Upload &upload = *uploads.front();
+        if (upload.expired()) {
+            discard(upload);
+            uploads.pop_front();
+            continue;
+        }
+        if (upload.array == 0 && upload.texture == 0) {
+            createTexture(upload);
+        }
+
+        // Compressed levels are copied a row of 4x4 blocks at a time
+        bool blocks = upload.cooked && upload.ktx.type == 0;
+        int width = upload.width, height = upload.height, rowHeight = 1, levelRows = upload.height;
+        size_t rowBytes = static_cast<size_t>(upload.width) * upload.components;
+        if (upload.cooked) {
+            const KtxLevel &level = upload.ktx.levels[upload.level];
+            width = level.width;
+            height = level.height;
+            rowHeight = blocks ? 4 : 1;
+            levelRows = (level.height + rowHeight - 1) / rowHeight;
+            rowBytes = level.size / levelRows;
+        }
+
+        // A row wider than the whole budget still goes through, alone in its frame
+        size_t fit = budget / rowBytes;
+        if (fit == 0 && budget < budgetBytes) {
+            break;
+        }
+        int rows = static_cast<int>(std::min<size_t>(levelRows - upload.rows, std::max<size_t>(1, fit)));
+        int top = upload.rows * rowHeight;
+        int texelRows = std::min(rows * rowHeight, height - top);
+        const void *offset = (const void*)(upload.levelOffset + upload.rows * rowBytes);
+        GLenum format = upload.cooked ? upload.ktx.format : textureFormat(upload.components);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.buffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (upload.array != 0) {
+            GLint layer = upload.layer.lock()->index;
+            glBindTexture(GL_TEXTURE_2D_ARRAY, upload.array);
+            if (blocks) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, top, layer, width, texelRows, 1,
+                                          upload.ktx.internalFormat, static_cast<GLsizei>(rows * rowBytes), offset);
+            } else {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, upload.level, 0, top, layer, width, texelRows, 1, format,
+                                GL_UNSIGNED_BYTE, offset);
+            }
+        } else {
+            glBindTexture(GL_TEXTURE_2D, upload.texture);
+            if (blocks) {
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, top, width, texelRows,
+                                          upload.ktx.internalFormat, static_cast<GLsizei>(rows * rowBytes), offset);
+            } else {
+                glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, top, width, texelRows, format, GL_UNSIGNED_BYTE,
+                                offset);
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        upload.rows += rows;
+        budget -= std::min(budget, rows * rowBytes);
+        if (upload.rows < levelRows) {
+            continue;
+        }
+
+        // Move on to the next cooked level, or finish the texture. Only an image
+        // that could not be cooked still has its mips made on the GPU
+        if (upload.cooked && upload.level < upload.lastLevel) {
+            upload.levelOffset += upload.ktx.levels[upload.level].size;
+            upload.level++;
+            upload.rows = 0;
+            continue;
+        }
+        if (!upload.cooked) {
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fenced.push_back(uploads.front());
+        uploads.pop_front();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Fences signal in submission order, so stop at the first one still pending
+    while (!fenced.empty()) {
+        Upload &upload = *fenced.front();
+        if (glClientWaitSync(upload.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        std::shared_ptr<TextureLayer> layer = upload.layer.lock();
+        std::shared_ptr<SharedTexture> target = upload.target.lock();
+        if (layer) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - upload.start;
+            layer->resident = true;
+            layer->residentLevel = upload.firstLevel;
+            layer->bytes = 0;
+            for (size_t i = upload.firstLevel; i < upload.ktx.levels.size(); i++) {
+                layer->bytes += upload.ktx.levels[i].size;
+            }
+            layer->loadMilliseconds += elapsed.count();
+            BlockFormat format;
+            const KtxLevel &finest = upload.ktx.levels[upload.firstLevel];
+            printf("Streamed %s into layer %d as %s: %dx%d from %dx%d, %.1f KB resident after %.2f ms\n",
+                   upload.path.c_str(), layer->index,
+                   blockFormatOf(upload.ktx.internalFormat, format) ? blockFormatName(format) : "RGBA8",
+                   finest.width, finest.height, upload.width, upload.height, layer->bytes / 1024.0, elapsed.count());
+        } else if (target) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - upload.start;
+            // The mip chain adds a third on top of the base level
+            size_t uncompressed = static_cast<size_t>(upload.width) * upload.height * upload.components * 4 / 3;
+            target->id = upload.texture;
+            target->resident = true;
+            target->bytes = upload.cooked ? upload.ktx.dataSize : uncompressed;
+            target->loadMilliseconds = elapsed.count();
+            upload.texture = 0;
+            BlockFormat format;
+            if (upload.cooked && blockFormatOf(upload.ktx.internalFormat, format)) {
+                printf("Streamed %s as %s: %dx%d, %.1f KB resident instead of %.1f KB after %.2f ms\n",
+                       upload.path.c_str(), blockFormatName(format), upload.width, upload.height,
+                       target->bytes / 1024.0, uncompressed / 1024.0, elapsed.count());
+            } else {
+                printf("Streamed %s: %dx%d, %.1f KB resident after %.2f ms\n", upload.path.c_str(),
+                       upload.width, upload.height, target->bytes / 1024.0, elapsed.count());
+            }
+        }
+        discard(upload);
+        fenced.pop_front();
+    }
+}
+
+void TextureStreamer::discard(Upload &upload) {
+    if (upload.fence) {
+        glDeleteSync(upload.fence);
+        upload.fence = 0;
+    }
+    if (upload.buffer != 0) {
+        glDeleteBuffers(1, &upload.buffer);
+        upload.buffer = 0;
+    }
+    if (upload.texture != 0) {
+        glDeleteTextures(1, &upload.texture);
+        upload.texture = 0;
+    }
+}
+
+void TextureStreamer::release() {
+    AssetLoader::instance().wait(decodes);
+    decodes.clear();
+    for (std::shared_ptr<Upload> &upload : uploads) {
+        discard(*upload);
+    }
+    for (std::shared_ptr<Upload> &upload : fenced) {
+        discard(*upload);
+    }
+    uploads.clear();
+    fenced.clear();
+    glDeleteTextures(TEXTURE_USAGE_COUNT, placeholders);
+    std::fill(placeholders, placeholders + TEXTURE_USAGE_COUNT, 0u);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "asset_loader.hpp"
+#include "asset_registry.hpp"
+#include "ktx_file.hpp"
+#include "texture_arrays.hpp"
+
+// Streams texture files in without stalling the render thread. Files are decoded
+// on AssetLoader workers into mapped pixel unpack buffers, then copied into their
+// texture a band of rows at a time within a per-frame byte budget. A fence marks
+// when the GPU has finished, and only then does the texture replace its placeholder.
+// Textures are cooked into KTX files the first time, block compressed with their
+// mip chain built on the CPU. Every level is read straight into the buffer and
+// copied a row, or a row of blocks, at a time. Maps packed into a texture array
+// are copied into their layer the same way, unless they cooked to a single colour
+class TextureStreamer {
+public:
+    // Bytes copied from pixel buffers into textures per update
+    size_t budgetBytes = 4 << 20;
+
+    static TextureStreamer& instance();
+
+    // Texture that shows the placeholder until the file is resident. Context thread only
+    std::shared_ptr<SharedTexture> stream(const char *path, TextureUsage usage);
+
+    // Fills levels firstLevel to lastLevel of a layer of a texture array holding layerSize
+    // square maps. The layer is resident, and its resident level moves down, once the GPU
+    // has them. Context thread only
+    void streamLayer(const char *path, TextureUsage usage, const std::shared_ptr<TextureLayer> &layer, GLuint array,
+                     int layerSize, int firstLevel, int lastLevel);
+
+    // Frees a streamed texture, which shows its placeholder until reload streams it in again
+    void evict(SharedTexture &texture);
+    void reload(const std::shared_ptr<SharedTexture> &texture);
+
+    // Spends one frame's budget and swaps in finished textures, call once per frame
+    void update();
+
+    // Loads still in flight
+    size_t pending() const { return decodes.size() + uploads.size() + fenced.size(); }
+
+    // Waits for the workers to stop writing into mapped buffers and frees every
+    // GL object the streamer owns, call before the context goes away
+    void release();
+
+    // Whether the driver samples S3TC blocks, which decides how colour is cooked
+    bool supportsS3tc();
+
+private:
+    struct Upload {
+        std::weak_ptr<SharedTexture> target;
+        std::weak_ptr<TextureLayer> layer; // instead of a target when filling a layer of an array
+        GLuint array = 0;
+        int layerSize = 0;
+        std::string path;
+        std::string packedPath; // cooked into alpha, layers only
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        bool cooked = false;
+        std::string cookedPath;
+        KtxInfo ktx;
+        GLuint buffer = 0;
+        GLuint texture = 0;
+        int firstLevel = 0; // levels read into the buffer, only cooked textures have more than one
+        int lastLevel = 0;
+        int level = 0; // level being copied
+        size_t levelOffset = 0; // offset of the level in the buffer
+        int rows = 0; // rows, or rows of blocks, of the level copied so far
+        GLsync fence = 0;
+        bool constant = false; // a layer cooked as one colour, nothing is copied
+        unsigned char colour[4] = {};
+        std::chrono::steady_clock::time_point start;
+
+        bool expired() const { return array != 0 ? layer.expired() : target.expired(); }
+        size_t levelsSize() const {
+            size_t size = 0;
+            for (int i = firstLevel; i <= lastLevel; i++) {
+                size += ktx.levels[i].size;
+            }
+            return size;
+        }
+    };
+
+    AssetLoader::Dependencies decodes;          // reading and decoding into pixel buffers
+    std::deque<std::shared_ptr<Upload>> uploads; // decoded, being copied into textures
+    std::deque<std::shared_ptr<Upload>> fenced;  // waiting for the GPU to finish
+    GLuint placeholders[TEXTURE_USAGE_COUNT] = {};
+    int s3tcSupport = -1; // unknown until the first texture is streamed
+
+    GLuint placeholderTexture(TextureUsage usage);
+    void load(const std::shared_ptr<Upload> &upload, TextureUsage usage);
+    void createTexture(Upload &upload);
+    void discard(Upload &upload);
+};
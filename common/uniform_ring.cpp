@@ -0,0 +1,104 @@
+#include "uniform_ring.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include "gl_extensions.hpp"
+
+UniformRing& UniformRing::instance() {
+    static UniformRing uniformRing;
+    return uniformRing;
+}
+
+void UniformRing::create() {
+    GLint offsetAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = offsetAlignment > 0 ? static_cast<size_t>(offsetAlignment) : 256;
+    frameBytes = (frameBytes + alignment - 1) / alignment * alignment;
+    GLsizeiptr size = static_cast<GLsizeiptr>(frameBytes * framesInFlight);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (hasExtension("GL_ARB_buffer_storage")) {
+        // Coherent, so writes reach the GPU without a flush
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        mapped = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags));
+        if (!mapped) {
+            // Storage cannot be respecified, so start again with a buffer mapped per block
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        }
+    }
+    if (!mapped) {
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    printf("Uniform ring of %d x %zu bytes, %s\n", framesInFlight, frameBytes,
+           mapped ? "persistently mapped" : "mapped per block");
+}
+
+void UniformRing::beginFrame() {
+    if (buffer == 0) {
+        create();
+    }
+    frame = (frame + 1) % framesInFlight;
+    offset = 0;
+    if (fences[frame]) {
+        // Frames are rarely this far behind, so wait in short steps rather than spin
+        while (glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(fences[frame]);
+        fences[frame] = nullptr;
+    }
+}
+
+void UniformRing::endFrame() {
+    if (buffer != 0 && offset > 0) {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+bool UniformRing::bind(UniformBlock block, const void *data, size_t size) {
+    if (buffer == 0 || offset + size > frameBytes) {
+        if (buffer != 0 && !reportedFull) {
+            printf("Uniform ring frame of %zu bytes is full, raise frameBytes\n", frameBytes);
+            reportedFull = true;
+        }
+        return false;
+    }
+    size_t start = static_cast<size_t>(frame) * frameBytes + offset;
+    if (mapped) {
+        memcpy(mapped + start, data, size);
+    } else {
+        // Nothing the GPU may still read is in the range, the fences saw to that
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        void *range = glMapBufferRange(GL_UNIFORM_BUFFER, static_cast<GLintptr>(start), static_cast<GLsizeiptr>(size),
+                                       flags);
+        if (!range) {
+            return false;
+        }
+        memcpy(range, data, size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, block, buffer, static_cast<GLintptr>(start), static_cast<GLsizeiptr>(size));
+    offset += (size + alignment - 1) / alignment * alignment;
+    return true;
+}
+
+void UniformRing::release() {
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (mapped) {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "shader_program.hpp"
+
+// Uniform blocks written for a single draw. One buffer is split into a region for
+// each frame in flight, which a frame fills from the start and fences once it is
+// submitted, so it is only written again after the GPU has read it. The buffer is
+// mapped once and written through where ARB_buffer_storage is supported, otherwise
+// each block maps its range unsynchronised, which the fences make safe. Context
+// thread only
+class UniformRing {
+public:
+    // Bytes of blocks one frame may write, set before the first frame
+    size_t frameBytes = 1u << 20;
+
+    static UniformRing& instance();
+
+    // Waits until the GPU is done with the region the frame reuses
+    void beginFrame();
+
+    // Fences the region the frame wrote, once its draws are issued
+    void endFrame();
+
+    // Copies a block into the frame's region and binds it for the next draws.
+    // False when the region is full, leaving the previous block bound
+    bool bind(UniformBlock block, const void *data, size_t size);
+
+    template <typename T>
+    bool bind(UniformBlock block, const T &data) { return bind(block, &data, sizeof(T)); }
+
+    void release();
+
+private:
+    static const int framesInFlight = 3;
+
+    GLuint buffer = 0;
+    char *mapped = nullptr; // the whole buffer while persistently mapped
+    GLsync fences[framesInFlight] = {};
+    int frame = 0;
+    size_t offset = 0; // next free byte of the frame's region
+    size_t alignment = 256;
+    bool reportedFull = false;
+
+    void create();
+};
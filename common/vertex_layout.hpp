@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <GL/glew.h>
+
+// One vertex attribute: the C++ type stored in the vertex and how GL reads it
+template <typename T, GLint Components, GLenum Type, GLboolean Normalized = GL_FALSE>
+struct VertexAttribute
+{
+    using value_type = T;
+    static constexpr GLint components = Components;
+    static constexpr GLenum type = Type;
+    static constexpr GLboolean normalized = Normalized;
+};
+
+// Interleaved vertex layout, attribute N is bound to shader location N
+template <typename... Attributes>
+struct VertexLayout
+{
+    static constexpr size_t count = sizeof...(Attributes);
+    static constexpr size_t stride = (sizeof(typename Attributes::value_type) + ... + 0);
+
+    // Byte offset of attribute N from the start of a vertex
+    static constexpr size_t offset(size_t index) {
+        constexpr size_t sizes[] = { sizeof(typename Attributes::value_type)... };
+        size_t total = 0;
+        for (size_t i = 0; i < index; i++) {
+            total += sizes[i];
+        }
+        return total;
+    }
+
+    // Points every attribute at the currently bound GL_ARRAY_BUFFER
+    static void apply() {
+        apply(std::index_sequence_for<Attributes...>());
+    }
+
+private:
+    template <size_t... Locations>
+    static void apply(std::index_sequence<Locations...>) {
+        (enable<Attributes>(Locations), ...);
+    }
+
+    template <typename Attribute>
+    static void enable(GLuint location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, Attribute::components, Attribute::type, Attribute::normalized,
+                              static_cast<GLsizei>(stride), reinterpret_cast<void*>(offset(location)));
+    }
+};
@@ -0,0 +1,151 @@
+#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+float signNotZero(float value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+int16_t toSnorm16(float value) {
+    return static_cast<int16_t>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+float fromSnorm16(int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+uint16_t toUnorm16(float value) {
+    return static_cast<uint16_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+// Signed normalised x, y, z in 10 bits each and the handedness in the top 2 bits,
+// as read by GL_INT_2_10_10_10_REV
+uint32_t packTangent(const glm::vec4 &tangent) {
+    uint32_t x = static_cast<uint32_t>(std::lround(glm::clamp(tangent.x, -1.0f, 1.0f) * 511.0f)) & 0x3FFu;
+    uint32_t y = static_cast<uint32_t>(std::lround(glm::clamp(tangent.y, -1.0f, 1.0f) * 511.0f)) & 0x3FFu;
+    uint32_t z = static_cast<uint32_t>(std::lround(glm::clamp(tangent.z, -1.0f, 1.0f) * 511.0f)) & 0x3FFu;
+    uint32_t w = tangent.w < 0.0f ? 0x3u : 0x1u;
+    return x | (y << 10) | (z << 20) | (w << 30);
+}
+
+glm::vec3 unpackTangent(uint32_t packed) {
+    glm::vec3 tangent;
+    for (int i = 0; i < 3; i++) {
+        // Sign extend each 10 bit field
+        int32_t field = static_cast<int32_t>((packed >> (10 * i)) & 0x3FFu);
+        field = (field ^ 0x200) - 0x200;
+        tangent[i] = std::max(field / 511.0f, -1.0f);
+    }
+    return tangent;
+}
+
+glm::vec3 safeNormalize(const glm::vec3 &vector, const glm::vec3 &fallback) {
+    float length = glm::length(vector);
+    return length > 1e-12f ? vector / length : fallback;
+}
+
+// Tangent orthogonalised against the normal, w is +1 or -1 so that
+// cross(normal, tangent) * w points along the original bitangent
+glm::vec4 tangentFrame(const Vertex &vertex) {
+    glm::vec3 normal = safeNormalize(vertex.normal, glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::vec3 tangent = vertex.tangent - normal * glm::dot(normal, vertex.tangent);
+    glm::vec3 fallback = std::fabs(normal.x) < 0.9f ? glm::cross(normal, glm::vec3(1.0f, 0.0f, 0.0f))
+                                                    : glm::cross(normal, glm::vec3(0.0f, 1.0f, 0.0f));
+    tangent = safeNormalize(tangent, glm::normalize(fallback));
+    float handedness = glm::dot(glm::cross(normal, tangent), vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+    return glm::vec4(tangent, handedness);
+}
+
+float angleDegrees(const glm::vec3 &a, const glm::vec3 &b) {
+    return glm::degrees(std::acos(glm::clamp(glm::dot(a, b), -1.0f, 1.0f)));
+}
+
+}
+
+glm::vec2 octahedralEncode(glm::vec3 normal) {
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    normal /= sum;
+    if (normal.z >= 0.0f) {
+        return glm::vec2(normal.x, normal.y);
+    }
+    // Fold the lower hemisphere over the diagonals
+    return glm::vec2((1.0f - std::fabs(normal.y)) * signNotZero(normal.x),
+                     (1.0f - std::fabs(normal.x)) * signNotZero(normal.y));
+}
+
+glm::vec3 octahedralDecode(glm::vec2 encoded) {
+    glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    if (normal.z < 0.0f) {
+        normal = glm::vec3((1.0f - std::fabs(encoded.y)) * signNotZero(encoded.x),
+                           (1.0f - std::fabs(encoded.x)) * signNotZero(encoded.y), normal.z);
+    }
+    return glm::normalize(normal);
+}
+
+PackingError packVertices(const Vertex *vertices, size_t count, VertexCompression compression,
+                          const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                          std::vector<unsigned char> &out) {
+    PackingError error;
+    size_t stride = vertexSize(compression);
+    out.resize(count * stride);
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    glm::vec3 inverseExtent;
+    for (int i = 0; i < 3; i++) {
+        inverseExtent[i] = extent[i] > 0.0f ? 1.0f / extent[i] : 0.0f;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const Vertex &vertex = vertices[i];
+        glm::vec4 tangent = tangentFrame(vertex);
+        glm::vec2 octahedral = octahedralEncode(vertex.normal);
+
+        PackedVertex packed;
+        packed.position  = vertex.position;
+        packed.uv[0]     = glm::packHalf1x16(vertex.uv.x);
+        packed.uv[1]     = glm::packHalf1x16(vertex.uv.y);
+        packed.normal[0] = toSnorm16(octahedral.x);
+        packed.normal[1] = toSnorm16(octahedral.y);
+        packed.tangent   = packTangent(tangent);
+
+        glm::vec3 decodedPosition = vertex.position;
+        if (compression == VERTEX_QUANTIZED) {
+            QuantizedVertex quantized;
+            glm::vec3 normalised = (vertex.position - boundsMin) * inverseExtent;
+            for (int axis = 0; axis < 3; axis++) {
+                quantized.position[axis] = toUnorm16(normalised[axis]);
+                decodedPosition[axis] = boundsMin[axis] + extent[axis] * (quantized.position[axis] / 65535.0f);
+            }
+            quantized.position[3] = 0;
+            memcpy(quantized.uv, packed.uv, sizeof(packed.uv));
+            memcpy(quantized.normal, packed.normal, sizeof(packed.normal));
+            quantized.tangent = packed.tangent;
+            memcpy(&out[i * stride], &quantized, sizeof(quantized));
+        } else {
+            memcpy(&out[i * stride], &packed, sizeof(packed));
+        }
+
+        // Measure what the vertex shader will decode against the float reference
+        glm::vec2 decodedUV(glm::unpackHalf1x16(packed.uv[0]), glm::unpackHalf1x16(packed.uv[1]));
+        glm::vec3 decodedNormal = octahedralDecode(glm::vec2(fromSnorm16(packed.normal[0]), fromSnorm16(packed.normal[1])));
+        glm::vec3 decodedTangent = safeNormalize(unpackTangent(packed.tangent), glm::vec3(tangent));
+        glm::vec3 positionDelta = glm::abs(decodedPosition - vertex.position);
+        glm::vec2 uvDelta = glm::abs(decodedUV - vertex.uv);
+        error.position = std::max(error.position, std::max(positionDelta.x, std::max(positionDelta.y, positionDelta.z)));
+        error.uv = std::max(error.uv, std::max(uvDelta.x, uvDelta.y));
+        if (glm::length(vertex.normal) > 1e-12f) {
+            error.normalDegrees = std::max(error.normalDegrees, angleDegrees(glm::normalize(vertex.normal), decodedNormal));
+        }
+        error.tangentDegrees = std::max(error.tangentDegrees, angleDegrees(glm::vec3(tangent), decodedTangent));
+    }
+    return error;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Largest error of a packed mesh against its float reference
+struct PackingError
+{
+    float position = 0.0f;
+    float uv = 0.0f;
+    float normalDegrees = 0.0f;
+    float tangentDegrees = 0.0f;
+};
+
+// Converts float vertices to a compressed format, quantising positions across the bounds
+PackingError packVertices(const Vertex *vertices, size_t count, VertexCompression compression,
+                          const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                          std::vector<unsigned char> &out);
+
+// Unit vector to and from the octahedral encoding used by the vertex shader
+glm::vec2 octahedralEncode(glm::vec3 normal);
+glm::vec3 octahedralDecode(glm::vec2 encoded);
@@ -1,4 +1,5 @@
 #include "glm/detail/type_vec.hpp"
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -12,6 +13,7 @@
 #include <set>
 #include FT_FREETYPE_H
 
+#include <common/asset_loader.hpp>
 #include <common/box_collider2d.hpp>
 #include <common/camera.hpp>
 #include <common/light.hpp>
@@ -19,7 +21,12 @@
 #include <common/model.hpp>
 #include <common/object.hpp>
 #include <common/shader.hpp>
+#include <common/shader_variants.hpp>
+#include <common/uniform_ring.hpp>
 #include <common/texture.hpp>
+#include <common/residency_manager.hpp>
+#include <common/texture_arrays.hpp>
+#include <common/texture_streamer.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/io.hpp>
 #include <string>
@@ -74,6 +81,14 @@ struct Character {
 
 Character characters[128];
 
+// Glyph rasterised on a worker, waiting for its texture
+struct GlyphBitmap {
+  std::vector<unsigned char> pixels;
+  glm::ivec2 size;
+  glm::ivec2 bearing;
+  uint32_t next;
+};
+
 struct TextRenderData {
   std::string text;
   glm::ivec2 position;
@@ -83,10 +98,13 @@ struct TextRenderData {
 
 std::vector<TextRenderData> textQueue;
 bool collisionDebugRendering = false;
+bool viewSpaceLighting = false; // lit in view space per fragment instead of lights moved to tangent space per vertex
 
 // Function prototypes
 void keyboardInput(GLFWwindow *window);
 void mouseInput(GLFWwindow *window);
+std::shared_ptr<std::vector<GlyphBitmap>> rasteriseGlyphs(const char *path);
+bool uploadGlyphs(const std::vector<GlyphBitmap> *glyphs);
 inline Camera &currentCamera() { return cameras[camera]; }
 
 int main(void) {
@@ -127,54 +145,94 @@ int main(void) {
     return -1;
   }
 
-  FT_Library ft;
-  if (FT_Init_FreeType(&ft)) {
-    std::cout << "FreeType Error: Could not init\n";
-    return -1;
-  }
+  // Start every load at once. CPU work runs on the loader's workers and the GL
+  // work each load ends with runs on this thread in loader.wait below. Textures
+  // keep streaming in behind placeholders after the first frame
+  AssetLoader &loader = AssetLoader::instance();
+  auto loadStart = std::chrono::steady_clock::now();
 
-  FT_Face font;
-  if (FT_New_Face(ft, "../assets/jetbrains_mono_regular.ttf", 0, &font)) {
-    std::cout << "FreeType Error: Could not load font\n";
-    return -1;
-  }
+  AssetHandle<std::shared_ptr<std::vector<GlyphBitmap>>> glyphBitmaps =
+      loader.async([]() { return rasteriseGlyphs("../assets/jetbrains_mono_regular.ttf"); });
+  AssetHandle<bool> glyphs = loader.upload(
+      [glyphBitmaps]() { return uploadGlyphs(glyphBitmaps.get().get()); },
+      {glyphBitmaps.dependency()});
 
-  FT_Set_Pixel_Sizes(font, 0, 48);
+  AssetHandle<unsigned int> textShader =
+      LoadShadersAsync("./textVertexShader.glsl", "./textFragmentShader.glsl");
 
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  for (size_t i = 0; i < 128; i++) {
-    if (FT_Load_Char(font, (FT_ULong) i, FT_LOAD_RENDER)) {
-      std::cout << "Could not load character: " << (char)i << "\n";
-      continue;
-    }
-    Character *character = &characters[i];
-    glGenTextures(1, &character->textureID);
-    glBindTexture(GL_TEXTURE_2D, character->textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, font->glyph->bitmap.width,
-                 font->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE,
-                 font->glyph->bitmap.buffer);
-    // No repeat + Linear filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // Lit programs are specialised on the scene's lights. Every combination of
+  // material maps is prepared so they build alongside the other loads
+  Light lights;
+
+  lights.addDirectionalLight(glm::vec3(1.0, -1.0f, 0.0f), glm::vec3(0.8f, 1.0f, 0.8f));
+  lights.addSpotLight(glm::vec3{0, 3, 0}, glm::vec3{0.0f, -1, 0}, glm::vec3(0.8f, 0.8f, 1.0f), 1.0f, 0.1f, 0.02f, Maths::radians(45));
+  lights.addPointLight(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.1f, 0.5f, 0.5f), 1.0f, 0.1f, 0.02f);
 
-    character->size =
-        glm::ivec2(font->glyph->bitmap.width, font->glyph->bitmap.rows);
-    character->bearing =
-        glm::ivec2(font->glyph->bitmap_left, font->glyph->bitmap_top);
-    character->next = font->glyph->advance.x;
+  ShaderVariants litShaders("./vertexShader.glsl", "./fragmentShader.glsl");
+  for (int maps = 0; maps < 4; maps++) {
+    MaterialFeatures material;
+    material.normalMap = (maps & 1) != 0;
+    material.specularMap = (maps & 2) != 0;
+    litShaders.prepare({lights.counts(), material});
   }
-  glBindTexture(GL_TEXTURE_2D, 0);
 
-  // Free FreeType internal memory
-  FT_Done_Face(font);
-  FT_Done_FreeType(ft);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 0);
+  AssetHandle<std::shared_ptr<Model>> tuxLoad = Model::loadAsync(
+      "../assets/tux.obj", VERTEX_QUANTIZED,
+      {{"../assets/onyx_diffuse.png", "diffuse"},
+       {"../assets/onyx_normal.png", "normal"},
+       {"../assets/onyx_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> boxLoad = Model::loadAsync(
+      "../assets/crate.obj", VERTEX_FLOAT,
+      {{"../assets/metal_diffuse.png", "diffuse"},
+       {"../assets/metal_normal.png", "normal"},
+       {"../assets/metal_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> wallLoad = Model::loadAsync(
+      "../assets/small_plane.obj", VERTEX_FLOAT,
+      {{"../assets/bricks_diffuse.png", "diffuse"},
+       {"../assets/bricks_normal.png", "normal"},
+       {"../assets/bricks_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> floorLoad = Model::loadAsync(
+      "../assets/small_plane.obj", VERTEX_FLOAT,
+      {{"../assets/wood_diffuse.png", "diffuse"},
+       {"../assets/wood_normal.png", "normal"},
+       {"../assets/wood_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> ceilingLoad = Model::loadAsync(
+      "../assets/small_plane.obj", VERTEX_FLOAT,
+      {{"../assets/plaster_diffuse.png", "diffuse"},
+       {"../assets/plaster_normal.png", "normal"},
+       {"../assets/plaster_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> teapotLoad = Model::loadAsync(
+      "../assets/teapot.obj", VERTEX_QUANTIZED,
+      {{"../assets/white.png", "diffuse"},
+       {"../assets/white.png", "normal"},
+       {"../assets/white.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> marbleLoad = Model::loadAsync(
+      "../assets/teapot.obj", VERTEX_QUANTIZED,
+      {{"../assets/marble_diffuse.png", "diffuse"},
+       {"../assets/marble_normal.png", "normal"},
+       {"../assets/marble_specular.png", "specular"}});
+  AssetHandle<std::shared_ptr<Model>> colliderDebugLoad = Model::loadAsync(
+      "../assets/unit_cube.obj", VERTEX_FLOAT,
+      {{"../assets/white.png", "diffuse"},
+       {"../assets/white.png", "normal"},
+       {"../assets/white.png", "specular"}});
+
+  AssetLoader::Dependencies startupLoads = {
+      glyphs.dependency(), textShader.dependency(), tuxLoad.dependency(),
+      boxLoad.dependency(), wallLoad.dependency(), floorLoad.dependency(),
+      ceilingLoad.dependency(), teapotLoad.dependency(), marbleLoad.dependency(),
+      colliderDebugLoad.dependency()};
+  AssetLoader::Dependencies shaderLoads = litShaders.pending();
+  startupLoads.insert(startupLoads.end(), shaderLoads.begin(), shaderLoads.end());
+  loader.wait(startupLoads);
+  std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+  fprintf(stdout, "Loaded assets in %.2f ms on %zu workers\n", loadTime.count(), loader.workerCount());
+  if (!glyphs.get()) {
+    return -1;
+  }
 
   // Init Text Buffers
-  uint32_t textShaderID =
-      LoadShaders("./textVertexShader.glsl", "./textFragmentShader.glsl");
+  ShaderProgram textProgram(textShader.get());
   uint32_t textVAO, textVBO;
   glGenVertexArrays(1, &textVAO);
   glGenBuffers(1, &textVBO);
@@ -200,18 +258,16 @@ int main(void) {
   glfwPollEvents();
   glfwSetCursorPos(window, width * 0.5f, height * 0.5f);
 
-  uint32_t shaderID =
-      LoadShaders("./vertexShader.glsl", "./fragmentShader.glsl");
-  uint32_t mvpID = glGetUniformLocation(shaderID, "MVP");
-  uint32_t mvID = glGetUniformLocation(shaderID, "MV");
-  uint32_t tintID = glGetUniformLocation(shaderID, "tint");
-  glUniform3fv(glGetUniformLocation(shaderID, "modelTint"), 1, glm::value_ptr(glm::vec3(1.0f)));
-
-  Light lights;
-
-  lights.addDirectionalLight(glm::vec3(1.0, -1.0f, 0.0f), glm::vec3(0.8f, 1.0f, 0.8f));
-  lights.addSpotLight(glm::vec3{0, 3, 0}, glm::vec3{0.0f, -1, 0}, glm::vec3(0.8f, 0.8f, 1.0f), 1.0f, 0.1f, 0.02f, Maths::radians(45));
-  lights.addPointLight(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.1f, 0.5f, 0.5f), 1.0f, 0.1f, 0.02f);
+  // Uniforms every draw with a variant shares, set the first time it is used in a frame.
+  // The window is not resizable, so the framebuffer keeps its size
+  int framebufferWidth, framebufferHeight;
+  glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+  litShaders.perFrame = [framebufferWidth, framebufferHeight](const ShaderProgram &program) {
+    TextureArrays::instance().bind(program);
+    program.set(Uniforms::tint, currentCamera().tint);
+    program.set(Uniforms::inverseProjection, glm::inverse(currentCamera().projection));
+    program.set(Uniforms::viewport, glm::vec4(0.0f, 0.0f, framebufferWidth, framebufferHeight));
+  };
 
   std::vector<BoxCollider2D> colliders;
   std::vector<Object> objects;
@@ -222,53 +278,27 @@ int main(void) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-  Model tux = Model("../assets/tux.obj");
-  tux.addTexture("../assets/onyx_diffuse.png", "diffuse");
-  tux.addTexture("../assets/onyx_normal.png", "normal");
-  tux.addTexture("../assets/onyx_specular.png", "specular");
+  Model &tux = *tuxLoad.get();
   tux.setDiffusionParameters(0.7f, 0.7f, 1.0f, 20.0f);
 
-  Model box = Model("../assets/crate.obj");
-  box.addTexture("../assets/metal_diffuse.png", "diffuse");
-  box.addTexture("../assets/metal_normal.png", "normal");
-  box.addTexture("../assets/metal_specular.png", "specular");
+  Model &box = *boxLoad.get();
   box.setDiffusionParameters(0.5f, 0.5f, 0.5f, 20.0f);
 
-  Model wall = Model("../assets/small_plane.obj");
-  wall.addTexture("../assets/bricks_diffuse.png", "diffuse");
-  wall.addTexture("../assets/bricks_normal.png", "normal");
-  wall.addTexture("../assets/bricks_specular.png", "specular");
+  Model &wall = *wallLoad.get();
   wall.setDiffusionParameters(0.1f, 0.7f, 1.0f, 20.0f);
 
-  Model floor = Model("../assets/small_plane.obj");
-  floor.addTexture("../assets/wood_diffuse.png", "diffuse");
-  floor.addTexture("../assets/wood_normal.png", "normal");
-  floor.addTexture("../assets/wood_specular.png", "specular");
+  Model &floor = *floorLoad.get();
   floor.setDiffusionParameters(0.05f, 0.7f, 1.0f, 20.0f);
 
-  Model ceiling = Model("../assets/small_plane.obj");
-  ceiling.addTexture("../assets/plaster_diffuse.png", "diffuse");
-  ceiling.addTexture("../assets/plaster_normal.png", "normal");
-  ceiling.addTexture("../assets/plaster_specular.png", "specular");
+  Model &ceiling = *ceilingLoad.get();
   ceiling.setDiffusionParameters(0.2f, 0.7f, 1.0f, 20.0f);
 
-  Model teapot = Model("../assets/teapot.obj");
-  teapot.addTexture("../assets/white.png", "diffuse");
-  teapot.addTexture("../assets/white.png", "normal");
-  teapot.addTexture("../assets/white.png", "specular");
+  Model &teapot = *teapotLoad.get();
 
-  Model marble = Model("../assets/teapot.obj");
-  marble.addTexture("../assets/marble_diffuse.png", "diffuse");
-  marble.addTexture("../assets/marble_normal.png", "normal");
-  marble.addTexture("../assets/marble_specular.png", "specular");
+  Model &marble = *marbleLoad.get();
   marble.setDiffusionParameters(objectDiffuseSettings);
 
-  Model colliderDebug = Model("../assets/unit_cube.obj");
-  colliderDebug.addTexture("../assets/white.png", "diffuse");
-  colliderDebug.addTexture("../assets/white.png", "normal");
-  colliderDebug.addTexture("../assets/white.png", "specular");
-
-  fprintf(stdout, "Loaded models\n");
+  Model &colliderDebug = *colliderDebugLoad.get();
 
   objects.push_back(Object(glm::vec3{0, 0, 0}, glm::vec3(0.01f),
                            Quaternion(), // Identity quaternion
@@ -322,7 +352,14 @@ int main(void) {
 
   textQueue.push_back(TextRenderData{ std::string("FPS: 0"), glm::vec2(10, 670), 1.0f, glm::vec3(1.0f, 1.0f, 0.0f) });
 
+  TextureStreamer &streamer = TextureStreamer::instance();
   while (!glfwWindowShouldClose(window)) {
+    // Finish loads that became ready and stream textures within the frame's budget
+    loader.pumpUploads();
+    streamer.update();
+    TextureArrays::instance().update();
+    ResidencyManager::instance().update();
+
     mouseDelta = {0.0f, 0.0f};
     movementInput = {0.0f, 0.0f};
     float time = (float)glfwGetTime();
@@ -436,10 +473,10 @@ int main(void) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDisable(GL_BLEND);
     glEnable(GL_DEPTH_TEST);
-    glUseProgram(shaderID);
-
-    glUniform3fv(tintID, 1, glm::value_ptr(currentCamera().tint));
-    lights.toShader(shaderID, currentCamera().view);
+    litShaders.viewSpaceLighting = viewSpaceLighting;
+    litShaders.beginFrame(lights.counts());
+    lights.upload(currentCamera().view);
+    UniformRing::instance().beginFrame();
 
     objects.front().tint = Maths::hslToRGB(glm::vec3(hue, 1, 0.75f));
     objects.front().rotation = Quaternion(0, time * M_PI);
@@ -447,40 +484,33 @@ int main(void) {
         glm::vec3(0, sinf(time * M_PI) * 0.25f + 1.0f, 0);
 
     for (Object &object : objects) {
-      glm::mat4 model = object.modelMat();
-
-      glm::mat4 mv = currentCamera().view * model;
-      glm::mat4 mvp = currentCamera().projection * mv;
-
-      glUniformMatrix4fv(mvpID, 1, GL_FALSE, glm::value_ptr(mvp));
-      glUniformMatrix4fv(mvID, 1, GL_FALSE, glm::value_ptr(mv));
-
-      object.draw(shaderID);
+      object.selectLod(currentCamera().position, currentCamera().projection, height);
+      object.requestTextures(currentCamera().position, currentCamera().projection, height);
+      object.draw(litShaders, currentCamera().view, currentCamera().projection);
     }
 
     if (collisionDebugRendering) {
+      const ShaderProgram &program = litShaders.use(colliderDebug.materialFeatures());
       for (BoxCollider2D &collider : colliders) {
         glm::mat4 model = Maths::translate(collider.position) * Maths::scale(glm::vec3(collider.size.x, 1, collider.size.y) * 1.05f);
-        glm::mat4 mv = currentCamera().view * model;
-        glm::mat4 mvp = currentCamera().projection * mv;
-
-        glUniformMatrix4fv(mvpID, 1, GL_FALSE, glm::value_ptr(mvp));
-        glUniformMatrix4fv(mvID, 1, GL_FALSE, glm::value_ptr(mv));
+        DrawBlock block;
+        block.MV = currentCamera().view * model;
+        block.MVP = currentCamera().projection * block.MV;
 
-        colliderDebug.draw(shaderID);
+        colliderDebug.draw(program, block);
       }
     }
 
     if (camera != FPS) {
+        const ShaderProgram &program = litShaders.use(teapot.materialFeatures());
         glm::mat4 model = Maths::translate(cameras[FPS].position) * Quaternion(0.0f, 0.5f * M_PI - cameras[FPS].yaw).matrix() * Maths::scale(glm::vec3(1.0f));
-        glm::mat4 mv = currentCamera().view * model;
-        glm::mat4 mvp = currentCamera().projection * mv;
+        DrawBlock block;
+        block.MV = currentCamera().view * model;
+        block.MVP = currentCamera().projection * block.MV;
 
-        glUniformMatrix4fv(mvpID, 1, GL_FALSE, glm::value_ptr(mvp));
-        glUniformMatrix4fv(mvID, 1, GL_FALSE, glm::value_ptr(mv));
-
-        teapot.draw(shaderID);
+        teapot.draw(program, block);
     }
+    UniformRing::instance().endFrame();
 
     glDisable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
@@ -488,14 +518,12 @@ int main(void) {
 
     const glm::mat4 textProjection =
         Maths::ortho(0.0f, width, 0.0f, height, 0.0f, 10.0f);
-    glUseProgram(textShaderID);
-    glUniformMatrix4fv(glGetUniformLocation(textShaderID, "projection"), 1,
-                       GL_FALSE, glm::value_ptr(textProjection));
+    glUseProgram(textProgram.id());
+    textProgram.set(Uniforms::projection, textProjection);
     for (TextRenderData &data : textQueue) {
       float x = data.position.x;
       float y = data.position.y;
-      glUniform3fv(glGetUniformLocation(textShaderID, "textColour"), 1,
-                   glm::value_ptr(data.colour));
+      textProgram.set(Uniforms::textColour, data.colour);
       glActiveTexture(GL_TEXTURE0);
       glBindVertexArray(textVAO);
       for (std::string::iterator it = data.text.begin(); it != data.text.end();
@@ -542,18 +570,92 @@ int main(void) {
   for (Object& object : objects) {
     models.insert(object.model);
   }
+  models.insert(&teapot);
+  models.insert(&colliderDebug);
   for (Model* model : models) {
     model->deleteBuffers();
   }
+  streamer.release();
+  TextureArrays::instance().release();
   for (Character& ch : characters) {
     glDeleteTextures(1, &ch.textureID);
   }
   glDeleteBuffers(1, &textVAO);
   glDeleteBuffers(1, &textVBO);
-  glDeleteProgram(shaderID);
+  litShaders.release();
+  lights.release();
+  UniformRing::instance().release();
   glfwTerminate();
 }
 
+std::shared_ptr<std::vector<GlyphBitmap>> rasteriseGlyphs(const char *path) {
+  FT_Library ft;
+  if (FT_Init_FreeType(&ft)) {
+    std::cout << "FreeType Error: Could not init\n";
+    return nullptr;
+  }
+
+  FT_Face font;
+  if (FT_New_Face(ft, path, 0, &font)) {
+    std::cout << "FreeType Error: Could not load font\n";
+    FT_Done_FreeType(ft);
+    return nullptr;
+  }
+
+  FT_Set_Pixel_Sizes(font, 0, 48);
+
+  auto glyphs = std::make_shared<std::vector<GlyphBitmap>>(128);
+  for (size_t i = 0; i < 128; i++) {
+    if (FT_Load_Char(font, (FT_ULong) i, FT_LOAD_RENDER)) {
+      std::cout << "Could not load character: " << (char)i << "\n";
+      continue;
+    }
+    // Copy out the bitmap, FreeType reuses it for the next glyph
+    GlyphBitmap &glyph = (*glyphs)[i];
+    const FT_Bitmap &bitmap = font->glyph->bitmap;
+    glyph.size = glm::ivec2(bitmap.width, bitmap.rows);
+    glyph.bearing = glm::ivec2(font->glyph->bitmap_left, font->glyph->bitmap_top);
+    glyph.next = font->glyph->advance.x;
+    for (unsigned int row = 0; row < bitmap.rows; row++) {
+      const unsigned char *line = bitmap.buffer + row * bitmap.pitch;
+      glyph.pixels.insert(glyph.pixels.end(), line, line + bitmap.width);
+    }
+  }
+
+  // Free FreeType internal memory
+  FT_Done_Face(font);
+  FT_Done_FreeType(ft);
+  return glyphs;
+}
+
+bool uploadGlyphs(const std::vector<GlyphBitmap> *glyphs) {
+  if (!glyphs) {
+    return false;
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t i = 0; i < glyphs->size(); i++) {
+    const GlyphBitmap &glyph = (*glyphs)[i];
+    Character *character = &characters[i];
+    glGenTextures(1, &character->textureID);
+    glBindTexture(GL_TEXTURE_2D, character->textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, glyph.size.x, glyph.size.y, 0,
+                 GL_RED, GL_UNSIGNED_BYTE,
+                 glyph.pixels.empty() ? nullptr : glyph.pixels.data());
+    // No repeat + Linear filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    character->size = glyph.size;
+    character->bearing = glyph.bearing;
+    character->next = glyph.next;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return true;
+}
+
 void keyboardInput(GLFWwindow *window) {
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
     glfwSetWindowShouldClose(window, true);
@@ -582,6 +684,12 @@ void keyboardInput(GLFWwindow *window) {
     renderTimer += 1.0f;
   }
 
+  if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && renderTimer <= 0.0f) {
+    viewSpaceLighting = !viewSpaceLighting;
+    std::cout << "Lighting: " << (viewSpaceLighting ? "view space" : "tangent space") << "\n";
+    renderTimer += 1.0f;
+  }
+
   if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && cameraTimer <= 0.0f) {
     cameraTimer += cameraDelay;
     int newCamera = camera - 1;
@@ -1,87 +1,164 @@
 #version 330 core
 
-# define maxLights 10
+// ShaderVariants defines how many lights of each type there are, point lights first
+// and directional lights last, and NORMAL_MAP and SPECULAR_MAP when the material
+// samples those maps. Without them the map's constant is used. VIEW_SPACE_LIGHTING
+// lights in view space from the interpolated tangent frame instead of lights the
+// vertex shader moved into tangent space
 
 // Inputs
 in vec2 UV;
+#ifdef VIEW_SPACE_LIGHTING
+in vec3 viewNormal;
+in vec4 viewTangent; // w is the bitangent handedness
+#else
 in vec3 fragmentPosition;
-in vec3 tangentSpaceLightPosition[maxLights];
-in vec3 tangentSpaceLightDirection[maxLights];
+in vec3 tangentSpaceLightPosition[LIGHT_SLOTS];
+in vec3 tangentSpaceLightDirection[LIGHT_SLOTS];
+#endif
 
 // Outputs
 out vec3 fragmentColour;
 
-// Light struct
+// Light struct, laid out as std140 packs it, a float filling each vec3 to 16 bytes
 struct Light
 {
     vec3 position;
-    vec3 colour;
-    vec3 direction;
     float constant;
+    vec3 colour;
     float linear;
+    vec3 direction;
     float quadratic;
     float cosPhi;
-    int type;
+};
+
+// Lights in view space, grouped by type, in a buffer filled once a frame
+layout(std140) uniform LightBlock
+{
+    Light lightSources[LIGHT_SLOTS];
+};
+
+// What one draw is drawn with, in a ring buffer the application writes every draw to
+layout(std140) uniform DrawBlock
+{
+    mat4 MVP;
+    mat4 MV;
+    vec4 materialConstants[3]; // colour of each map that is one colour or missing
+    vec3 positionScale;        // vertex format decoding, identity for float vertices
+    bool packedVertex;
+    vec3 positionOffset;
+    float ka;
+    vec3 modelTint;
+    float kd;
+    ivec3 materialLayers; // layer of each map, -1 while streaming, -2 when not in an array,
+                          // -3 when one colour and -4 for specular in the diffuse alpha
+    float ks;
+    float Ns;
 };
 
 // Uniforms
-uniform vec3 modelTint = vec3(1);
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
 uniform sampler2D specularMap;
-uniform float ka;
-uniform float kd;
-uniform float ks;
-uniform float Ns;
-uniform Light lightSources[maxLights];
+uniform sampler2DArray diffuseMaps;
+uniform sampler2DArray normalMaps;
+uniform sampler2DArray specularMaps;
 uniform vec3 tint;
+uniform mat4 inverseProjection; // view space lighting rebuilds the position from the depth
+uniform vec4 viewport;
 
 // Function prototypes
+vec3 lightPosition(int i);
+
+vec3 lightDirection(int i);
+
 vec3 pointLight(int i);
 
 vec3 spotLight(int i);
 
 vec3 directionalLight(int i);
 
-// Get the normal vector from the normal map
-vec3 Normal = normalize(2.0 * vec3(texture(normalMap, UV)) - 1.0);
+vec4 sampleMap(sampler2D map, sampler2DArray maps, int layer, vec4 placeholder, vec4 constant);
+
+#ifdef VIEW_SPACE_LIGHTING
+vec3 fragmentPosition;
+#endif
+
+// Material maps, sampled once for every light
+vec3 Normal;
+vec3 DiffuseColour;
+vec3 SpecularColour;
 
 void main() {
+    // Get the normal vector from the normal map, which only stores x and y when
+    // compressed, so z is rebuilt from the unit length
+#ifdef NORMAL_MAP
+    vec2 normalXY = 2.0 * sampleMap(normalMap, normalMaps, materialLayers.y, vec4(0.5, 0.5, 1.0, 1.0),
+                                    materialConstants[1]).rg - 1.0;
+#else
+    vec2 normalXY = 2.0 * materialConstants[1].rg - 1.0;
+#endif
+    Normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+
+#ifdef VIEW_SPACE_LIGHTING
+    // Position from the window coordinates and depth, and the normal moved out of tangent space
+    vec4 ndc = vec4(2.0 * (gl_FragCoord.xy - viewport.xy) / viewport.zw - 1.0, 2.0 * gl_FragCoord.z - 1.0, 1.0);
+    vec4 view = inverseProjection * ndc;
+    fragmentPosition = view.xyz / view.w;
+    vec3 n = normalize(viewNormal);
+    vec3 t = normalize(viewTangent.xyz - dot(viewTangent.xyz, n) * n);
+    vec3 b = cross(n, t) * (viewTangent.w < 0.0 ? -1.0 : 1.0);
+    Normal = mat3(t, b, n) * Normal;
+#endif
+    vec4 diffuse = sampleMap(diffuseMap, diffuseMaps, materialLayers.x, vec4(0.5), materialConstants[0]);
+    DiffuseColour = vec3(diffuse);
+#ifdef SPECULAR_MAP
+    if (materialLayers.z == -4)
+        SpecularColour = vec3(diffuse.a);
+    else
+        SpecularColour = vec3(sampleMap(specularMap, specularMaps, materialLayers.z, vec4(0.5), materialConstants[2]));
+#else
+    SpecularColour = vec3(materialConstants[2]);
+#endif
+
+    // Lights are grouped by type, so no fragment branches on it
     fragmentColour = vec3(0.0, 0.0, 0.0);
-    for (int i = 0; i < maxLights; i++) { // Determine light properties for current light source
-        vec3 lightPosition = tangentSpaceLightPosition[i];
-        vec3 lightColour = lightSources[i].colour;
-        vec3 lightDirection = tangentSpaceLightDirection[i];
-        float constant = lightSources[i].constant;
-        float linear = lightSources[i].linear;
-        float quadratic = lightSources[i].quadratic;
-        float cosPhi = lightSources[i].cosPhi;
-
-        // Calculate point light
-        if (lightSources[i].type == 1)
-            fragmentColour += pointLight(i);
-
-        // Calculate spotlight
-        if (lightSources[i].type == 2)
-            fragmentColour += spotLight(i);
-
-        // Calculate directional light
-        if (lightSources[i].type == 3)
-            fragmentColour += directionalLight(i);
-    }
+    for (int i = 0; i < POINT_LIGHTS; i++)
+        fragmentColour += pointLight(i);
+    for (int i = POINT_LIGHTS; i < POINT_LIGHTS + SPOT_LIGHTS; i++)
+        fragmentColour += spotLight(i);
+    for (int i = POINT_LIGHTS + SPOT_LIGHTS; i < LIGHT_COUNT; i++)
+        fragmentColour += directionalLight(i);
     fragmentColour *= tint * modelTint;
 }
 
+// Light position and direction in the space lighting is done in
+vec3 lightPosition(int i) {
+#ifdef VIEW_SPACE_LIGHTING
+    return lightSources[i].position;
+#else
+    return tangentSpaceLightPosition[i];
+#endif
+}
+
+vec3 lightDirection(int i) {
+#ifdef VIEW_SPACE_LIGHTING
+    return lightSources[i].direction;
+#else
+    return tangentSpaceLightDirection[i];
+#endif
+}
+
 // Calculate point light
 vec3 pointLight(int i) {
     // Object colour
-    vec3 objectColour = vec3(texture(diffuseMap, UV));
+    vec3 objectColour = DiffuseColour;
 
     // Ambient reflection
     vec3 ambient = ka * objectColour;
 
     // Diffuse reflection
-    vec3 light = normalize(tangentSpaceLightPosition[i] - fragmentPosition);
+    vec3 light = normalize(lightPosition(i) - fragmentPosition);
     vec3 normal = normalize(Normal);
     float cosTheta = max(dot(normal, light), 0);
     vec3 diffuse = kd * lightSources[i].colour * objectColour * cosTheta;
@@ -91,10 +168,10 @@ vec3 pointLight(int i) {
     vec3 camera = normalize(-fragmentPosition);
     float cosAlpha = max(dot(camera, reflection), 0);
     vec3 specular = ks * lightSources[i].colour * pow(cosAlpha, Ns);
-    specular *= vec3(texture(specularMap, UV));
+    specular *= SpecularColour;
 
     // Attenuation
-    float distance = length(tangentSpaceLightPosition[i] - fragmentPosition);
+    float distance = length(lightPosition(i) - fragmentPosition);
     float attenuation = 1.0 / (lightSources[i].constant + lightSources[i].linear * distance +
                 lightSources[i].quadratic * distance * distance);
 
@@ -105,13 +182,13 @@ vec3 pointLight(int i) {
 // Calculate spotlight
 vec3 spotLight(int i) {
     // Object colour
-    vec3 objectColour = vec3(texture(diffuseMap, UV));
+    vec3 objectColour = DiffuseColour;
 
     // Ambient reflection
     vec3 ambient = ka * objectColour;
 
     // Diffuse reflection
-    vec3 light = normalize(tangentSpaceLightPosition[i] - fragmentPosition);
+    vec3 light = normalize(lightPosition(i) - fragmentPosition);
     vec3 normal = normalize(Normal);
     float cosTheta = max(dot(normal, light), 0);
     vec3 diffuse = kd * lightSources[i].colour * objectColour * cosTheta;
@@ -121,15 +198,15 @@ vec3 spotLight(int i) {
     vec3 camera = normalize(-fragmentPosition);
     float cosAlpha = max(dot(camera, reflection), 0);
     vec3 specular = ks * lightSources[i].colour * pow(cosAlpha, Ns);
-    specular *= vec3(texture(specularMap, UV));
+    specular *= SpecularColour;
 
     // Attenuation
-    float distance = length(tangentSpaceLightPosition[i] - fragmentPosition);
+    float distance = length(lightPosition(i) - fragmentPosition);
     float attenuation = 1.0 / (lightSources[i].constant + lightSources[i].linear * distance +
                 lightSources[i].quadratic * distance * distance);
 
     // Directional light intensity
-    vec3 direction = normalize(tangentSpaceLightDirection[i]);
+    vec3 direction = normalize(lightDirection(i));
     cosTheta = dot(-light, direction);
     float delta = radians(2.0);
     float intensity = clamp((cosTheta - lightSources[i].cosPhi) / delta, 0.0, 1.0);
@@ -141,13 +218,13 @@ vec3 spotLight(int i) {
 // Calculate directional light
 vec3 directionalLight(int i) {
     // Object colour
-    vec3 objectColour = vec3(texture(diffuseMap, UV));
+    vec3 objectColour = DiffuseColour;
 
     // Ambient reflection
     vec3 ambient = ka * objectColour;
 
     // Diffuse reflection
-    vec3 light = normalize(-tangentSpaceLightDirection[i]);
+    vec3 light = normalize(-lightDirection(i));
     vec3 normal = normalize(Normal);
     float cosTheta = max(dot(normal, light), 0);
     vec3 diffuse = kd * lightSources[i].colour * objectColour * cosTheta;
@@ -157,8 +234,19 @@ vec3 directionalLight(int i) {
     vec3 camera = normalize(-fragmentPosition);
     float cosAlpha = max(dot(camera, reflection), 0);
     vec3 specular = ks * lightSources[i].colour * pow(cosAlpha, Ns);
-    specular *= vec3(texture(specularMap, UV));
+    specular *= SpecularColour;
 
     // Return fragment colour
     return ambient + diffuse + specular;
 }
+
+// Sample a material map from its layer of an array, or from its own texture
+vec4 sampleMap(sampler2D map, sampler2DArray maps, int layer, vec4 placeholder, vec4 constant) {
+    if (layer >= 0)
+        return texture(maps, vec3(UV, layer));
+    if (layer == -1)
+        return placeholder;
+    if (layer == -3)
+        return constant;
+    return texture(map, UV);
+}
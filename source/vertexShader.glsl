@@ -1,57 +1,104 @@
 #version 330 core
 
-# define maxLights 10
+// ShaderVariants defines LIGHT_COUNT and LIGHT_SLOTS, the lights there are and
+// the array size, which is at least one. VIEW_SPACE_LIGHTING outputs the tangent
+// frame instead of every light in tangent space
 
 // Inputs
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec2 uv;
 layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 tangent;
+layout(location = 3) in vec4 tangent; // w is the bitangent handedness when packed
 layout(location = 4) in vec3 bitangent;
 
 // Outputs
 out vec2 UV;
+#ifdef VIEW_SPACE_LIGHTING
+out vec3 viewNormal;
+out vec4 viewTangent; // w is the bitangent handedness
+#else
 out vec3 fragmentPosition;
-out vec3 tangentSpaceLightPosition[maxLights];
-out vec3 tangentSpaceLightDirection[maxLights];
+out vec3 tangentSpaceLightPosition[LIGHT_SLOTS];
+out vec3 tangentSpaceLightDirection[LIGHT_SLOTS];
+#endif
 
-// Light struct
+// Light struct, laid out as std140 packs it, a float filling each vec3 to 16 bytes
 struct Light {
     vec3 position;
-    vec3 colour;
-    vec3 direction;
     float constant;
+    vec3 colour;
     float linear;
+    vec3 direction;
     float quadratic;
     float cosPhi;
-    int type;
 };
 
-// Uniforms
-uniform mat4 MVP;
-uniform mat4 MV;
-uniform Light lightSources[maxLights];
+// Lights in view space, grouped by type, in a buffer filled once a frame
+layout(std140) uniform LightBlock {
+    Light lightSources[LIGHT_SLOTS];
+};
+
+// What one draw is drawn with, in a ring buffer the application writes every draw to
+layout(std140) uniform DrawBlock {
+    mat4 MVP;
+    mat4 MV;
+    vec4 materialConstants[3]; // colour of each map that is one colour or missing
+    vec3 positionScale;        // vertex format decoding, identity for float vertices
+    bool packedVertex;
+    vec3 positionOffset;
+    float ka;
+    vec3 modelTint;
+    float kd;
+    ivec3 materialLayers; // layer of each map, -1 while streaming, -2 when not in an array,
+                          // -3 when one colour and -4 for specular in the diffuse alpha
+    float ks;
+    float Ns;
+};
+
+// Decode an octahedral encoded unit vector
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main() {
+    // Decode the vertex attributes
+    vec3 objectPosition = position * positionScale + positionOffset;
+    vec3 objectNormal = normal;
+    float handedness = dot(cross(normal, tangent.xyz), bitangent) < 0.0 ? -1.0 : 1.0;
+    if (packedVertex) {
+        objectNormal = octahedralDecode(normal.xy);
+        handedness = tangent.w < 0.0 ? -1.0 : 1.0;
+    }
+
     // Output vertex position
-    gl_Position = MVP * vec4(position, 1.0);
+    gl_Position = MVP * vec4(objectPosition, 1.0);
 
     // Output texture co-ordinates
     UV = uv;
 
     // Calculate the TBN matrix that transforms view space to tangent space
     mat3 invMV = transpose(inverse(mat3(MV)));
-    vec3 t = normalize(invMV * tangent);
-    vec3 n = normalize(invMV * normal);
+    vec3 t = normalize(invMV * tangent.xyz);
+    vec3 n = normalize(invMV * objectNormal);
     t = normalize(t - dot(t, n) * n);
-    vec3 b = cross(n, t);
+
+#ifdef VIEW_SPACE_LIGHTING
+    // The fragment shader rebuilds the bitangent and its position from the depth
+    viewNormal = n;
+    viewTangent = vec4(t, handedness);
+#else
+    vec3 b = cross(n, t) * handedness;
     mat3 TBN = transpose(mat3(t, b, n));
 
     // Output tangent space fragment position, light positions and directions
-    fragmentPosition = TBN * vec3(MV * vec4(position, 1.0));
+    fragmentPosition = TBN * vec3(MV * vec4(objectPosition, 1.0));
 
-    for (int i = 0; i < maxLights; i++) {
+    for (int i = 0; i < LIGHT_COUNT; i++) {
         tangentSpaceLightPosition[i] = TBN * lightSources[i].position;
         tangentSpaceLightDirection[i] = TBN * lightSources[i].direction;
     }
+#endif
 }